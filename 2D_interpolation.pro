@@ -1,8 +1,46 @@
 QMAKE_CXXFLAGS += -Wall -Werror -W
-CONFIG += debug
+CONFIG += debug c++17 thread
+count_allocations {
+    DEFINES += INTERPOLATION_COUNT_ALLOCATIONS
+}
+stats {
+    DEFINES += INTERPOLATION_STATS
+}
 HEADERS       = window.h \
-    interpolation.h
+    interpolation.h \
+    interpolation_view.h \
+    cubic_kernel.h \
+    segment_table.h \
+    tridiagonal.h \
+    multi_interpolation.h \
+    alloc_counter.h \
+    envelope_pyramid.h \
+    interpolation_file.h \
+    stream_fit.h \
+    stats.h \
+    test_functions.h \
+    eytzinger_index.h \
+    thread_pool.h \
+    parallel_evaluate.h \
+    error_norms.h \
+    convergence.h
 SOURCES       = main.cpp \
                 interpolation.cpp \
+                interpolation_view.cpp \
+                cubic_kernel.cpp \
+                segment_table.cpp \
+                tridiagonal.cpp \
+                multi_interpolation.cpp \
+                alloc_counter.cpp \
+                envelope_pyramid.cpp \
+                interpolation_file.cpp \
+                stream_fit.cpp \
+                stats.cpp \
+                test_functions.cpp \
+                eytzinger_index.cpp \
+                thread_pool.cpp \
+                parallel_evaluate.cpp \
+                error_norms.cpp \
+                convergence.cpp \
                 window.cpp
 QT += widgets
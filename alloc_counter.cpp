@@ -0,0 +1,115 @@
+#include "alloc_counter.h"
+
+#ifdef INTERPOLATION_COUNT_ALLOCATIONS
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<size_t> allocations(0);
+
+static void *counted_alloc(size_t size, size_t align)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (size == 0) {
+        size = 1;
+    }
+    if (align <= alignof(std::max_align_t)) {
+        return malloc(size);
+    }
+    size = (size + align - 1) / align * align;
+    return aligned_alloc(align, size);
+}
+
+static void *checked_alloc(size_t size, size_t align)
+{
+    void *p = counted_alloc(size, align);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void *operator new(size_t size)
+{
+    return checked_alloc(size, 0);
+}
+
+void *operator new[](size_t size)
+{
+    return checked_alloc(size, 0);
+}
+
+void *operator new(size_t size, std::align_val_t align)
+{
+    return checked_alloc(size, static_cast<size_t>(align));
+}
+
+void *operator new[](size_t size, std::align_val_t align)
+{
+    return checked_alloc(size, static_cast<size_t>(align));
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept
+{
+    return counted_alloc(size, 0);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept
+{
+    return counted_alloc(size, 0);
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept
+{
+    free(p);
+}
+
+void operator delete(void *p, std::align_val_t) noexcept
+{
+    free(p);
+}
+
+void operator delete[](void *p, std::align_val_t) noexcept
+{
+    free(p);
+}
+
+void operator delete(void *p, size_t, std::align_val_t) noexcept
+{
+    free(p);
+}
+
+void operator delete[](void *p, size_t, std::align_val_t) noexcept
+{
+    free(p);
+}
+
+size_t allocation_count()
+{
+    return allocations.load(std::memory_order_relaxed);
+}
+
+#else
+
+size_t allocation_count()
+{
+    return 0;
+}
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef ALLOC_COUNTER_H
+#define ALLOC_COUNTER_H
+
+#include <cstddef>
+
+// Number of global operator new calls made so far. The counting operators
+// are compiled in only with INTERPOLATION_COUNT_ALLOCATIONS defined (qmake
+// CONFIG+=count_allocations or cmake -DINTERPOLATION_COUNT_ALLOCATIONS=ON);
+// otherwise this always returns 0. interpolation_bench built that way
+// compares the count before and after warmed-up refits and fails if any
+// of them allocated.
+size_t allocation_count();
+
+#endif // ALLOC_COUNTER_H
@@ -0,0 +1,471 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <unistd.h>
+#include <vector>
+
+#include "convergence.h"
+#include "error_norms.h"
+#include "interpolation.h"
+#include "interpolation_file.h"
+#include "parallel_evaluate.h"
+#include "stats.h"
+#include "stream_fit.h"
+#include "test_functions.h"
+
+// Headless front end: fits, saves and evaluates without Qt.
+
+struct batch_options {
+    bool fit = false;
+    double a = 0.;
+    double b = 0.;
+    int n = 0;
+    int func_id = 0;
+    const char *load = nullptr;
+    const char *ingest = nullptr;
+    sample_format ingest_format = sample_format::csv;
+    const char *save = nullptr;
+    int grid = 0;
+    const char *points = nullptr;
+    const char *output = "-";
+    bool binary = false;
+    bool study = false;
+    int max_n = 0;
+    // Every registered function when set.
+    bool all_functions = false;
+    int threads = 0;
+    size_t grain = default_evaluate_grain;
+    bool stats = false;
+    // Points per segment for the error norms, 0 for none.
+    int error_points = 0;
+    double tolerance = -1.;
+    std::vector<interpolation_method> methods;
+};
+
+static const char *method_names[] = {"origin", "bessel", "spline",
+                                     "error_bessel", "error_spline"};
+static const int method_count = 5;
+
+static void usage(const char *name)
+{
+    printf("Usage %s SOURCE [--save FILE] [QUERY] [OUTPUT]\n"
+           "SOURCE, exactly one of:\n"
+           "  --fit a b n k             fit func k on n uniform nodes of [a, b]\n"
+           "  --load FILE               map a saved fit\n"
+           "  --ingest csv|binary FILE  fit (x, y) samples, '-' for stdin\n"
+           "  --study a b n0 N k|all    convergence table of func k on\n"
+           "                            (n0 - 1) 2^j + 1 <= N nodes, sampled at\n"
+           "                            --errors p points per segment\n"
+           "QUERY:\n"
+           "  --grid m                  m uniform points of [a, b]\n"
+           "  --points FILE             x values, one per line\n"
+           "OUTPUT:\n"
+           "  --method NAME             origin, bessel, spline, error_bessel,\n"
+           "                            error_spline or all; repeatable\n"
+           "  --output FILE             results, '-' (default) for stdout\n"
+           "  --format csv|binary       rows of x and values (default csv)\n"
+           "  --threads t               evaluation threads, 0 for all cores\n"
+           "  --grain g                 points per evaluation task\n"
+           "  --stats                   print hot-path counters to stderr\n"
+           "CHECK:\n"
+           "  --errors p                print max and L2 errors of both methods\n"
+           "                            against the function to stderr, sampled\n"
+           "                            at p points per segment\n"
+           "  --tolerance t             exit with status 2 if a max error is\n"
+           "                            above t; implies --errors 16\n",
+           name);
+}
+
+static bool parse_method(const char *name,
+                         std::vector<interpolation_method> &methods)
+{
+    if (strcmp(name, "all") == 0) {
+        for (int k = 0; k < method_count; k++) {
+            methods.push_back(static_cast<interpolation_method>(k));
+        }
+        return true;
+    }
+    for (int k = 0; k < method_count; k++) {
+        if (strcmp(name, method_names[k]) == 0) {
+            methods.push_back(static_cast<interpolation_method>(k));
+            return true;
+        }
+    }
+    return false;
+}
+
+static int parse_options(int argc, char *argv[], batch_options &opts)
+{
+    int sources = 0;
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        int left = argc - i - 1;
+
+        if (strcmp(arg, "--fit") == 0 && left >= 4) {
+            if (sscanf(argv[i + 1], "%lf", &opts.a) != 1 ||
+                sscanf(argv[i + 2], "%lf", &opts.b) != 1 ||
+                opts.b - opts.a < 1.e-6 ||
+                sscanf(argv[i + 3], "%d", &opts.n) != 1 || opts.n < 3 ||
+                sscanf(argv[i + 4], "%d", &opts.func_id) != 1 ||
+                !find_function(opts.func_id)) {
+                return 1;
+            }
+            opts.fit = true;
+            sources++;
+            i += 4;
+        } else if (strcmp(arg, "--study") == 0 && left >= 5) {
+            opts.all_functions = strcmp(argv[i + 5], "all") == 0;
+            if (sscanf(argv[i + 1], "%lf", &opts.a) != 1 ||
+                sscanf(argv[i + 2], "%lf", &opts.b) != 1 ||
+                opts.b - opts.a < 1.e-6 ||
+                sscanf(argv[i + 3], "%d", &opts.n) != 1 || opts.n < 3 ||
+                sscanf(argv[i + 4], "%d", &opts.max_n) != 1 ||
+                opts.max_n < opts.n ||
+                (!opts.all_functions &&
+                 sscanf(argv[i + 5], "%d", &opts.func_id) != 1)) {
+                return 1;
+            }
+            opts.study = true;
+            sources++;
+            i += 5;
+        } else if (strcmp(arg, "--load") == 0 && left >= 1) {
+            opts.load = argv[++i];
+            sources++;
+        } else if (strcmp(arg, "--ingest") == 0 && left >= 2) {
+            if (strcmp(argv[i + 1], "csv") == 0) {
+                opts.ingest_format = sample_format::csv;
+            } else if (strcmp(argv[i + 1], "binary") == 0) {
+                opts.ingest_format = sample_format::binary;
+            } else {
+                return 1;
+            }
+            opts.ingest = argv[i + 2];
+            sources++;
+            i += 2;
+        } else if (strcmp(arg, "--save") == 0 && left >= 1) {
+            opts.save = argv[++i];
+        } else if (strcmp(arg, "--grid") == 0 && left >= 1) {
+            if (sscanf(argv[++i], "%d", &opts.grid) != 1 || opts.grid < 2) {
+                return 1;
+            }
+        } else if (strcmp(arg, "--points") == 0 && left >= 1) {
+            opts.points = argv[++i];
+        } else if (strcmp(arg, "--method") == 0 && left >= 1) {
+            if (!parse_method(argv[++i], opts.methods)) {
+                return 1;
+            }
+        } else if (strcmp(arg, "--output") == 0 && left >= 1) {
+            opts.output = argv[++i];
+        } else if (strcmp(arg, "--format") == 0 && left >= 1) {
+            i++;
+            if (strcmp(argv[i], "csv") == 0) {
+                opts.binary = false;
+            } else if (strcmp(argv[i], "binary") == 0) {
+                opts.binary = true;
+            } else {
+                return 1;
+            }
+        } else if (strcmp(arg, "--threads") == 0 && left >= 1) {
+            if (sscanf(argv[++i], "%d", &opts.threads) != 1 ||
+                opts.threads < 0) {
+                return 1;
+            }
+        } else if (strcmp(arg, "--grain") == 0 && left >= 1) {
+            if (sscanf(argv[++i], "%zu", &opts.grain) != 1 ||
+                opts.grain < 2) {
+                return 1;
+            }
+        } else if (strcmp(arg, "--stats") == 0) {
+            opts.stats = true;
+        } else if (strcmp(arg, "--errors") == 0 && left >= 1) {
+            if (sscanf(argv[++i], "%d", &opts.error_points) != 1 ||
+                opts.error_points < 1) {
+                return 1;
+            }
+        } else if (strcmp(arg, "--tolerance") == 0 && left >= 1) {
+            if (sscanf(argv[++i], "%lf", &opts.tolerance) != 1 ||
+                !(opts.tolerance >= 0.)) {
+                return 1;
+            }
+        } else {
+            return 1;
+        }
+    }
+
+    if (sources != 1 || (opts.grid > 0 && opts.points)) {
+        return 1;
+    }
+    if (opts.study && (opts.save || opts.grid > 0 || opts.points ||
+                       opts.tolerance >= 0.)) {
+        return 1;
+    }
+    if (opts.methods.empty()) {
+        opts.methods.push_back(interpolation_method::spline);
+    }
+    if (opts.tolerance >= 0. && opts.error_points == 0) {
+        opts.error_points = default_norm_points;
+    }
+    return 0;
+}
+
+// First number of every non-blank, non-comment line.
+static int read_points(const char *path, std::vector<double> &xs)
+{
+    FILE *in = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+    if (!in) {
+        return file_open_error;
+    }
+
+    char line[1024];
+    int status = file_ok;
+    while (fgets(line, sizeof(line), in)) {
+        char *p = line;
+        while (*p == ' ' || *p == '\t') {
+            p++;
+        }
+        if (*p == '\0' || *p == '\n' || *p == '\r' || *p == '#') {
+            continue;
+        }
+        char *end;
+        double x = strtod(p, &end);
+        if (end == p) {
+            status = file_data_error;
+            break;
+        }
+        xs.push_back(x);
+    }
+
+    if (in != stdin) {
+        fclose(in);
+    }
+    return status;
+}
+
+static int write_results(const batch_options &opts,
+                         const std::vector<double> &xs,
+                         const std::vector<double> &values)
+{
+    bool to_stdout = strcmp(opts.output, "-") == 0;
+    FILE *out =
+        to_stdout ? stdout : fopen(opts.output, opts.binary ? "wb" : "w");
+    if (!out) {
+        return file_open_error;
+    }
+
+    size_t count = xs.size();
+    size_t columns = opts.methods.size();
+    bool written = true;
+
+    if (opts.binary) {
+        std::vector<double> row(columns + 1);
+        for (size_t i = 0; i < count && written; i++) {
+            row[0] = xs[i];
+            for (size_t m = 0; m < columns; m++) {
+                row[m + 1] = values[m * count + i];
+            }
+            written = fwrite(row.data(), sizeof(double), row.size(), out) ==
+                      row.size();
+        }
+    } else {
+        fprintf(out, "x");
+        for (interpolation_method method : opts.methods) {
+            fprintf(out, ",%s", method_names[static_cast<int>(method)]);
+        }
+        fprintf(out, "\n");
+        for (size_t i = 0; i < count; i++) {
+            fprintf(out, "%.17g", xs[i]);
+            for (size_t m = 0; m < columns; m++) {
+                fprintf(out, ",%.17g", values[m * count + i]);
+            }
+            fprintf(out, "\n");
+        }
+        written = !ferror(out);
+    }
+
+    if (to_stdout) {
+        written = fflush(out) == 0 && written;
+    } else {
+        written = fclose(out) == 0 && written;
+    }
+    return written ? file_ok : file_io_error;
+}
+
+// One row per function and level: n, then value and order of the max and
+// L2 errors of each method.
+static int run_study(const batch_options &opts, thread_pool &pool)
+{
+    FILE *out = strcmp(opts.output, "-") == 0 ? stdout
+                                               : fopen(opts.output, "w");
+    if (!out) {
+        fprintf(stderr, "Cannot open %s\n", opts.output);
+        return 1;
+    }
+
+    fprintf(out, "func_id,n,bessel_max,bessel_max_order,bessel_l2,"
+                 "bessel_l2_order,spline_max,spline_max_order,spline_l2,"
+                 "spline_l2_order\n");
+    int first = opts.all_functions ? 0 : opts.func_id;
+    int last = opts.all_functions ? function_count() - 1 : opts.func_id;
+    int points = opts.error_points > 0 ? opts.error_points
+                                       : default_norm_points;
+    int status = 0;
+    for (int k = first; k <= last && status == 0; k++) {
+        std::vector<convergence_level> levels;
+        if (!convergence_study(pool, opts.a, opts.b, opts.n, opts.max_n, k,
+                               points, levels)) {
+            fprintf(stderr, "No reference function for func_id %d\n", k);
+            status = 1;
+        }
+        for (const convergence_level &l : levels) {
+            fprintf(out,
+                    "%d,%d,%.17g,%.17g,%.17g,%.17g,%.17g,%.17g,%.17g,%.17g\n",
+                    k, l.n, l.errors.bessel.max_error,
+                    l.orders.bessel.max_error, l.errors.bessel.l2_error,
+                    l.orders.bessel.l2_error, l.errors.spline.max_error,
+                    l.orders.spline.max_error, l.errors.spline.l2_error,
+                    l.orders.spline.l2_error);
+        }
+    }
+
+    bool written = !ferror(out);
+    written = (out == stdout ? fflush(out) : fclose(out)) == 0 && written;
+    if (!written) {
+        fprintf(stderr, "Cannot write %s\n", opts.output);
+        return 1;
+    }
+    return status;
+}
+
+int main(int argc, char *argv[])
+{
+    batch_options opts;
+    if (parse_options(argc, argv, opts) != 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if (opts.study) {
+        thread_pool pool(opts.threads);
+        int status = run_study(opts, pool);
+        if (opts.stats) {
+            fputs(stats_report().c_str(), stderr);
+        }
+        return status;
+    }
+
+    std::unique_ptr<interpolation> fit;
+    mapped_interpolation mapped;
+    interpolation_view view;
+    int status = file_ok;
+
+    if (opts.fit) {
+        fit.reset(new interpolation(opts.a, opts.b, opts.n, opts.func_id));
+        view = fit->view();
+        if (opts.save) {
+            status = save_interpolation(view, opts.save);
+        }
+    } else {
+        const char *path = opts.load ? opts.load : opts.save;
+        char temp_path[] = "/tmp/interpolation_XXXXXX";
+
+        if (opts.ingest) {
+            if (!path) {
+                int fd = mkstemp(temp_path);
+                if (fd < 0) {
+                    fprintf(stderr, "Cannot create a temporary file\n");
+                    return 1;
+                }
+                close(fd);
+                path = temp_path;
+            }
+            FILE *in = strcmp(opts.ingest, "-") == 0
+                           ? stdin
+                           : fopen(opts.ingest,
+                                   opts.ingest_format == sample_format::binary
+                                       ? "rb"
+                                       : "r");
+            if (!in) {
+                status = file_open_error;
+            } else {
+                status = ingest_samples(in, opts.ingest_format, path);
+                if (in != stdin) {
+                    fclose(in);
+                }
+            }
+        }
+        if (status == file_ok) {
+            status = mapped.open(path);
+        }
+        // The mapping outlives the name.
+        if (path == temp_path) {
+            unlink(temp_path);
+        }
+        view = mapped.view();
+        if (status == file_ok && opts.load && opts.save) {
+            status = save_interpolation(view, opts.save);
+        }
+    }
+    if (status != file_ok) {
+        fprintf(stderr, "Cannot build the fit: error %d\n", status);
+        return 1;
+    }
+
+    std::vector<double> xs;
+    if (opts.grid > 0) {
+        xs.resize(opts.grid);
+        for (int i = 0; i < opts.grid; i++) {
+            xs[i] = view.a + (view.b - view.a) * i / (opts.grid - 1);
+        }
+    } else if (opts.points) {
+        status = read_points(opts.points, xs);
+        if (status != file_ok) {
+            fprintf(stderr, "Cannot read %s: error %d\n", opts.points,
+                    status);
+            return 1;
+        }
+    }
+
+    thread_pool pool(opts.threads);
+    if (opts.grid > 0 || opts.points) {
+        size_t count = xs.size();
+        std::vector<double> values(opts.methods.size() * count);
+        for (size_t m = 0; m < opts.methods.size(); m++) {
+            parallel_evaluate(pool, view, xs.data(), values.data() + m * count,
+                              count, opts.methods[m], opts.grain);
+        }
+
+        status = write_results(opts, xs, values);
+        if (status != file_ok) {
+            fprintf(stderr, "Cannot write %s: error %d\n", opts.output,
+                    status);
+            return 1;
+        }
+    }
+
+    if (opts.stats) {
+        fputs(stats_report().c_str(), stderr);
+    }
+
+    if (opts.error_points > 0) {
+        fit_errors errors;
+        if (!measure_errors(pool, view, opts.error_points, errors)) {
+            fprintf(stderr, "No reference function for func_id %d\n",
+                    view.func_id);
+            return 1;
+        }
+        fprintf(stderr, "bessel max %.17g l2 %.17g\n",
+                errors.bessel.max_error, errors.bessel.l2_error);
+        fprintf(stderr, "spline max %.17g l2 %.17g\n",
+                errors.spline.max_error, errors.spline.l2_error);
+        if (opts.tolerance >= 0. &&
+            !(errors.bessel.max_error <= opts.tolerance &&
+              errors.spline.max_error <= opts.tolerance)) {
+            fprintf(stderr, "Max error above tolerance %g\n",
+                    opts.tolerance);
+            return 2;
+        }
+    }
+    return 0;
+}
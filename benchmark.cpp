@@ -0,0 +1,458 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "alloc_counter.h"
+#include "error_norms.h"
+#include "interpolation.h"
+#include "multi_interpolation.h"
+#include "parallel_evaluate.h"
+#include "test_functions.h"
+#include "tridiagonal.h"
+
+#ifdef INTERPOLATION_BENCH_PAINT
+#include "window.h"
+#include <QApplication>
+#include <QImage>
+#include <QLabel>
+#endif
+
+// Times the fit and evaluation hot paths over a sweep of n, func_id and
+// query order, and prints the best of several runs as JSON. Built with
+// INTERPOLATION_BENCH_PAINT (needs Qt) it also times Window painting into
+// an offscreen QImage. Built with INTERPOLATION_COUNT_ALLOCATIONS it first
+// checks that warmed-up refits do not allocate, and fails if they do.
+
+struct bench_options {
+    long long min_n = 4;
+    long long max_n = 1000000;
+    int queries = 1 << 20;
+    int repeats = 3;
+    const char *output = "-";
+};
+
+struct bench_result {
+    std::string name;
+    long long n;
+    int func_id;
+    const char *pattern;
+    long long ops;
+    double seconds;
+};
+
+static double now()
+{
+    return std::chrono::duration<double>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+// Best wall time of repeats runs of work.
+template <typename Work> static double best_time(int repeats, Work work)
+{
+    double best = 0.;
+    for (int r = 0; r < repeats; r++) {
+        double start = now();
+        work();
+        double elapsed = now() - start;
+        if (r == 0 || elapsed < best) {
+            best = elapsed;
+        }
+    }
+    return best;
+}
+
+// Keeps results alive so the evaluation loops are not optimized away.
+static volatile double sink;
+
+static void bench_solver(const bench_options &opts, long long n,
+                         std::vector<bench_result> &results)
+{
+    int m = static_cast<int>(n);
+    std::vector<double> low(m, 1.);
+    std::vector<double> diag(m, 4.);
+    std::vector<double> up(m, 1.);
+    std::vector<double> rhs(m, 6.);
+    std::vector<double> b(m);
+    tridiagonal_lu lu;
+
+    double t =
+        best_time(opts.repeats, [&]() { lu.factor(low, diag, up, m, 1); });
+    results.push_back({"tridiagonal_factor", n, -1, "none", n, t});
+
+    t = best_time(opts.repeats, [&]() {
+        b = rhs;
+        lu.solve(b.data());
+    });
+    results.push_back({"tridiagonal_solve", n, -1, "none", n, t});
+
+    lu.factor(low, diag, up, m, 0);
+    t = best_time(opts.repeats, [&]() {
+        b = rhs;
+        lu.solve(b.data());
+    });
+    results.push_back({"tridiagonal_solve_parallel", n, -1, "none", n, t});
+}
+
+static void bench_fit(const bench_options &opts, thread_pool &pool,
+                      long long n, int func_id,
+                      std::vector<bench_result> &results)
+{
+    double a = -1.;
+    double b = 1.;
+    int m = static_cast<int>(n);
+
+    double t = best_time(opts.repeats, [&]() {
+        interpolation f(a, b, m, func_id);
+        sink = f.view().x[0];
+    });
+    results.push_back({"construct", n, func_id, "none", n, t});
+
+    // Alternates with the next function, since refitting the same one is
+    // a no-op; the spline factorization is reused either way.
+    interpolation f(a, b, m, func_id);
+    int next = (func_id + 1) % builtin_function_count;
+    int other = next;
+    t = best_time(opts.repeats, [&]() {
+        f.change_func(other);
+        other = f.view().func_id == func_id ? next : func_id;
+    });
+    results.push_back({"refit", n, func_id, "none", n, t});
+    f.change_func(func_id);
+
+    // Alternates the middle node between two precomputed values, so only
+    // update_node is timed.
+    int mid = m / 2;
+    double values[2] = {f.view().f_x[mid], f.view().f_x[mid] + 0.1};
+    int turn = 0;
+    t = best_time(opts.repeats,
+                  [&]() { f.update_node(mid, values[++turn % 2]); });
+    results.push_back({"update_node", n, func_id, "none", 1, t});
+    f.update_node(mid, values[0]);
+
+    fit_errors errors;
+    t = best_time(opts.repeats, [&]() {
+        measure_errors(pool, f.view(), default_norm_points, errors);
+        sink = errors.spline.l2_error;
+    });
+    results.push_back({"error_norms", n, func_id, "none",
+                       (n - 1) * default_norm_points, t});
+
+    std::mt19937_64 gen(n * 7 + func_id);
+    std::uniform_real_distribution<double> uniform(a, b);
+    std::vector<double> xs(opts.queries);
+    std::vector<double> out(opts.queries);
+
+    for (int sorted = 0; sorted < 2; sorted++) {
+        const char *pattern = sorted ? "sorted" : "random";
+        for (double &x : xs) {
+            x = uniform(gen);
+        }
+        if (sorted) {
+            std::sort(xs.begin(), xs.end());
+        }
+        long long q = opts.queries;
+
+        t = best_time(opts.repeats, [&]() {
+            double sum = 0.;
+            for (double x : xs) {
+                sum += f.bessel(x);
+            }
+            sink = sum;
+        });
+        results.push_back({"bessel", n, func_id, pattern, q, t});
+
+        t = best_time(opts.repeats, [&]() {
+            double sum = 0.;
+            for (double x : xs) {
+                sum += f.spline(x);
+            }
+            sink = sum;
+        });
+        results.push_back({"spline", n, func_id, pattern, q, t});
+
+        t = best_time(opts.repeats, [&]() {
+            interpolation_cursor cursor(f.view());
+            double sum = 0.;
+            for (double x : xs) {
+                sum += cursor.spline(x);
+            }
+            sink = sum;
+        });
+        results.push_back({"cursor_spline", n, func_id, pattern, q, t});
+
+        t = best_time(opts.repeats, [&]() {
+            long long sum = 0;
+            for (double x : xs) {
+                sum += f.binary_search(x);
+            }
+            sink = static_cast<double>(sum);
+        });
+        results.push_back({"binary_search", n, func_id, pattern, q, t});
+
+        t = best_time(opts.repeats, [&]() {
+            f.evaluate(xs.data(), out.data(), xs.size(),
+                       interpolation_method::bessel);
+        });
+        results.push_back({"evaluate_bessel", n, func_id, pattern, q, t});
+
+        t = best_time(opts.repeats, [&]() {
+            f.evaluate(xs.data(), out.data(), xs.size(),
+                       interpolation_method::spline);
+        });
+        results.push_back({"evaluate_spline", n, func_id, pattern, q, t});
+
+        t = best_time(opts.repeats, [&]() {
+            parallel_evaluate(pool, f.view(), xs.data(), out.data(),
+                              xs.size(), interpolation_method::spline);
+        });
+        results.push_back(
+            {"parallel_evaluate_spline", n, func_id, pattern, q, t});
+    }
+}
+
+// Segment lookup on n jittered nodes of [-1, 1]: plain binary_search
+// against the Eytzinger index behind find_segment.
+static void bench_irregular(const bench_options &opts, long long n,
+                            std::vector<bench_result> &results)
+{
+    int m = static_cast<int>(n);
+    std::mt19937_64 gen(n);
+    std::uniform_real_distribution<double> jitter(0.5, 1.5);
+    std::vector<double> nodes(m);
+    std::vector<double> values(m);
+    double x = 0.;
+    for (int i = 0; i < m; i++) {
+        nodes[i] = x;
+        values[i] = sin(x);
+        x += jitter(gen);
+    }
+
+    interpolation f(nodes, values);
+    interpolation_view v = f.view();
+    std::uniform_real_distribution<double> uniform(nodes[0], nodes[m - 1]);
+    std::vector<double> xs(opts.queries);
+    std::vector<double> out(opts.queries);
+    for (double &q : xs) {
+        q = uniform(gen);
+    }
+    long long q = opts.queries;
+
+    double t = best_time(opts.repeats, [&]() {
+        long long sum = 0;
+        for (double p : xs) {
+            sum += v.binary_search(p);
+        }
+        sink = static_cast<double>(sum);
+    });
+    results.push_back({"binary_search_irregular", n, -1, "random", q, t});
+
+    t = best_time(opts.repeats, [&]() {
+        long long sum = 0;
+        for (double p : xs) {
+            sum += v.find_segment(p);
+        }
+        sink = static_cast<double>(sum);
+    });
+    results.push_back({"index_search_irregular", n, -1, "random", q, t});
+
+    t = best_time(opts.repeats, [&]() {
+        f.evaluate(xs.data(), out.data(), xs.size(),
+                   interpolation_method::spline);
+    });
+    results.push_back({"evaluate_spline_irregular", n, -1, "random", q, t});
+}
+
+#ifdef INTERPOLATION_BENCH_PAINT
+static void bench_paint(const bench_options &opts, long long n, int func_id,
+                        std::vector<bench_result> &results)
+{
+    const int width = 1200;
+    const int height = 800;
+    QLabel log_label;
+    QLabel method_label;
+    Window window(nullptr, &log_label, &method_label);
+    window.resize(width, height);
+
+    std::string args[5] = {"bench", "-1", "1", std::to_string(n),
+                           std::to_string(func_id)};
+    char *argv[5];
+    for (int i = 0; i < 5; i++) {
+        argv[i] = &args[i][0];
+    }
+    window.parse_command_line(5, argv);
+    while (!window.fit_ready()) {
+        QApplication::processEvents(QEventLoop::WaitForMoreEvents, 10);
+    }
+
+    QImage image(width + 1, height, QImage::Format_ARGB32_Premultiplied);
+
+    // Curves sampled by the worker: only the drawing.
+    double t = best_time(opts.repeats, [&]() { window.render(&image); });
+    results.push_back({"paint", n, func_id, "none", width, t});
+
+    // Every resize drops the cached samples, so this also samples.
+    int r = 0;
+    t = best_time(opts.repeats, [&]() {
+        window.resize(width + (++r % 2), height);
+        window.render(&image);
+    });
+    results.push_back({"resize_paint", n, func_id, "none", width, t});
+}
+#endif
+
+#ifdef INTERPOLATION_COUNT_ALLOCATIONS
+// Allocations made by work, run once more after a warm-up run.
+template <typename Work> static size_t steady_allocations(Work work)
+{
+    work();
+    size_t before = allocation_count();
+    work();
+    return allocation_count() - before;
+}
+
+// Refits below parallel_solve_min_n, which run on the calling thread.
+static bool check_allocations()
+{
+    const int n = 1000;
+    const int channels = 3;
+    interpolation f(-1., 1., n, 0);
+    multi_interpolation multi(-1., 1., n, channels);
+    std::vector<double> values(n * channels);
+    int round = 0;
+
+    struct {
+        const char *name;
+        size_t count;
+    } checks[] = {
+        {"change_func", steady_allocations([&]() {
+             f.change_func(1);
+             f.change_func(6);
+         })},
+        {"set_disturb",
+         steady_allocations([&]() { f.set_disturb(++round % 3); })},
+        {"update_node",
+         steady_allocations([&]() { f.update_node(7, 0.1 * ++round); })},
+        {"multi_set_values", steady_allocations([&]() {
+             for (size_t k = 0; k < values.size(); k++) {
+                 values[k] = sin(0.01 * k + ++round);
+             }
+             multi.set_values(values.data());
+         })},
+    };
+
+    bool ok = true;
+    for (const auto &check : checks) {
+        if (check.count != 0) {
+            fprintf(stderr, "%s made %zu allocations\n", check.name,
+                    check.count);
+            ok = false;
+        }
+    }
+    return ok;
+}
+#endif
+
+static void print_results(FILE *out, const std::vector<bench_result> &results)
+{
+    fprintf(out, "{\n");
+    fprintf(out, "  \"isa\": \"%s\",\n", cubic_eval_isa());
+    fprintf(out, "  \"hardware_threads\": %u,\n",
+            std::thread::hardware_concurrency());
+    fprintf(out, "  \"results\": [\n");
+    for (size_t i = 0; i < results.size(); i++) {
+        const bench_result &r = results[i];
+        fprintf(out,
+                "    {\"name\": \"%s\", \"n\": %lld, \"func_id\": %d, "
+                "\"pattern\": \"%s\", \"ops\": %lld, \"seconds\": %.9g, "
+                "\"ns_per_op\": %.6g}%s\n",
+                r.name.c_str(), r.n, r.func_id, r.pattern, r.ops, r.seconds,
+                r.seconds * 1e9 / r.ops, i + 1 < results.size() ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+}
+
+int main(int argc, char *argv[])
+{
+#ifdef INTERPOLATION_BENCH_PAINT
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+    QApplication app(argc, argv);
+#endif
+
+    bench_options opts;
+    for (int i = 1; i < argc; i++) {
+        bool has_value = i + 1 < argc;
+        if (strcmp(argv[i], "--min-n") == 0 && has_value) {
+            opts.min_n = atoll(argv[++i]);
+        } else if (strcmp(argv[i], "--max-n") == 0 && has_value) {
+            opts.max_n = atoll(argv[++i]);
+        } else if (strcmp(argv[i], "--queries") == 0 && has_value) {
+            opts.queries = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--repeats") == 0 && has_value) {
+            opts.repeats = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--output") == 0 && has_value) {
+            opts.output = argv[++i];
+        } else {
+            printf("Usage %s [--min-n n] [--max-n n] [--queries q] "
+                   "[--repeats r] [--output file]\n",
+                   argv[0]);
+            return 1;
+        }
+    }
+    if (opts.min_n < 4 || opts.max_n < opts.min_n || opts.max_n > INT32_MAX ||
+        opts.queries < 1 || opts.repeats < 1) {
+        printf("Need 4 <= min-n <= max-n < 2^31, queries and repeats >= 1\n");
+        return 1;
+    }
+
+    // n = 4, 10, 100, ... and max_n itself.
+    std::vector<long long> sizes;
+    for (long long n = 4; n <= opts.max_n; n = n < 10 ? 10 : n * 10) {
+        if (n >= opts.min_n) {
+            sizes.push_back(n);
+        }
+    }
+    if (sizes.empty() || sizes.back() != opts.max_n) {
+        sizes.push_back(opts.max_n);
+    }
+
+#ifdef INTERPOLATION_COUNT_ALLOCATIONS
+    if (!check_allocations()) {
+        return 1;
+    }
+#endif
+
+    thread_pool pool;
+    std::vector<bench_result> results;
+    for (long long n : sizes) {
+        bench_solver(opts, n, results);
+        bench_irregular(opts, n, results);
+        for (int func_id = 0; func_id < builtin_function_count; func_id++) {
+            bench_fit(opts, pool, n, func_id, results);
+#ifdef INTERPOLATION_BENCH_PAINT
+            bench_paint(opts, n, func_id, results);
+#endif
+            fprintf(stderr, "n = %lld, func_id = %d done\n", n, func_id);
+        }
+    }
+
+    FILE *out = strcmp(opts.output, "-") == 0 ? stdout
+                                                : fopen(opts.output, "w");
+    if (!out) {
+        printf("Cannot open %s\n", opts.output);
+        return 1;
+    }
+    print_results(out, results);
+    if (out != stdout) {
+        fclose(out);
+    }
+    return 0;
+}
@@ -0,0 +1,171 @@
+#include "convergence.h"
+#include "cubic_kernel.h"
+#include "interpolation.h"
+#include "parallel_evaluate.h"
+#include "test_functions.h"
+#include <algorithm>
+#include <cmath>
+#include <memory>
+
+static double order(double coarse, double fine)
+{
+    if (!(coarse > 0.) || !(fine > 0.)) {
+        return 0.;
+    }
+    return log2(coarse / fine);
+}
+
+// The grids share the exact nodes: step_k = (b - a) / ((n0 - 1) 2^k) is the
+// finest spacing times a power of two, so a + j * step_k is bitwise the
+// finest sample with index j * points * 2^(last - k). Level k samples the
+// left ends of points equal subintervals per segment, which are the finest
+// samples with index a multiple of 2^(last - k); since f - p vanishes at
+// the nodes, their sum is the trapezoid rule for the L2 norm.
+bool convergence_study(thread_pool &pool, double a, double b, int n0,
+                       int max_n, int func_id, int points_per_segment,
+                       std::vector<convergence_level> &levels)
+{
+    const test_function *fn = find_function(func_id);
+    if (!fn || n0 < 2 || max_n < n0) {
+        return false;
+    }
+
+    int points_shift = 0;
+    while ((1 << points_shift) < points_per_segment) {
+        points_shift++;
+    }
+    int points = 1 << points_shift;
+
+    int count = 1;
+    while ((static_cast<long long>(n0) - 1) * (2LL << (count - 1)) + 1 <=
+           max_n) {
+        count++;
+    }
+    int finest_n = (n0 - 1) * (1 << (count - 1)) + 1;
+    double step = (b - a) / (finest_n - 1);
+    double spacing = step / points;
+
+    std::vector<double> nodes(finest_n);
+    size_t grain = default_evaluate_grain;
+    pool.run((finest_n + grain - 1) / grain, [&](size_t k) {
+        const size_t block_size = 256;
+        double xs[block_size];
+        size_t last = (k + 1) * grain < static_cast<size_t>(finest_n)
+                          ? (k + 1) * grain
+                          : finest_n;
+        for (size_t first = k * grain; first < last; first += block_size) {
+            size_t len =
+                last - first < block_size ? last - first : block_size;
+            for (size_t m = 0; m < len; m++) {
+                xs[m] = a + (first + m) * step;
+            }
+            fn->values(xs, nodes.data() + first, len);
+        }
+    });
+
+    std::vector<std::unique_ptr<interpolation>> fits(count);
+    pool.run(count, [&](size_t k) {
+        int n = (n0 - 1) * (1 << k) + 1;
+        size_t stride = static_cast<size_t>(1) << (count - 1 - k);
+        std::vector<double> node_values(n);
+        for (int i = 0; i < n; i++) {
+            node_values[i] = nodes[i * stride];
+        }
+        fits[k].reset(new interpolation(a, b, n, func_id, node_values));
+    });
+
+    std::vector<interpolation_view> views(count);
+    std::vector<char> spline_fitted(count);
+    for (int k = 0; k < count; k++) {
+        views[k] = fits[k]->view();
+        spline_fitted[k] = fabs(views[k].x[1] - views[k].x[0]) > views[k].eps;
+    }
+
+    // One pass over the finest samples: every block of f values is used by
+    // all levels while it is in cache, and no sample array is stored.
+    size_t samples = static_cast<size_t>(finest_n - 1) * points;
+    size_t tasks = (samples + grain - 1) / grain;
+    std::vector<error_sums> bessel(tasks * count);
+    std::vector<error_sums> spline(tasks * count);
+    pool.run(tasks, [&](size_t task) {
+        const size_t block_size = 256;
+        int seg[block_size];
+        double xs[block_size];
+        double exact[block_size];
+        double level_xs[block_size];
+        double level_exact[block_size];
+        double w[block_size];
+        double approx[block_size];
+
+        size_t last = (task + 1) * grain < samples ? (task + 1) * grain
+                                                   : samples;
+        for (size_t first = task * grain; first < last;
+             first += block_size) {
+            size_t len =
+                last - first < block_size ? last - first : block_size;
+            for (size_t m = 0; m < len; m++) {
+                xs[m] = a + (first + m) * spacing;
+            }
+            fn->values(xs, exact, len);
+
+            for (int k = 0; k < count; k++) {
+                int shift = count - 1 - k;
+                size_t stride = static_cast<size_t>(1) << shift;
+                size_t m = (first + stride - 1) & ~(stride - 1);
+                int seg_shift = shift + points_shift;
+                size_t level_len = 0;
+                for (; m < first + len; m += stride) {
+                    seg[level_len] = static_cast<int>(m >> seg_shift);
+                    level_xs[level_len] = xs[m - first];
+                    level_exact[level_len] = exact[m - first];
+                    w[level_len] = spacing * stride;
+                    level_len++;
+                }
+                if (level_len == 0) {
+                    continue;
+                }
+
+                size_t slot = task * count + k;
+                cubic_eval(views[k].bessel_coeffs, seg, level_xs, approx,
+                           level_len);
+                bessel[slot].add(level_exact, approx, w, level_len);
+                if (spline_fitted[k]) {
+                    cubic_eval(views[k].spline_coeffs, seg, level_xs, approx,
+                               level_len);
+                } else {
+                    std::fill(approx, approx + level_len, 0.);
+                }
+                spline[slot].add(level_exact, approx, w, level_len);
+            }
+        }
+    });
+
+    levels.assign(count, convergence_level());
+    for (int k = 0; k < count; k++) {
+        error_sums bessel_total;
+        error_sums spline_total;
+        for (size_t task = 0; task < tasks; task++) {
+            bessel_total.merge(bessel[task * count + k]);
+            spline_total.merge(spline[task * count + k]);
+        }
+
+        convergence_level &level = levels[k];
+        level.n = (n0 - 1) * (1 << k) + 1;
+        level.errors.bessel = bessel_total.norms();
+        level.errors.spline = spline_total.norms();
+
+        if (k == 0) {
+            continue;
+        }
+        const fit_errors &prev = levels[k - 1].errors;
+        level.orders.bessel.max_error =
+            order(prev.bessel.max_error, level.errors.bessel.max_error);
+        level.orders.bessel.l2_error =
+            order(prev.bessel.l2_error, level.errors.bessel.l2_error);
+        level.orders.spline.max_error =
+            order(prev.spline.max_error, level.errors.spline.max_error);
+        level.orders.spline.l2_error =
+            order(prev.spline.l2_error, level.errors.spline.l2_error);
+    }
+    return true;
+}
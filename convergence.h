@@ -0,0 +1,29 @@
+#ifndef CONVERGENCE_H
+#define CONVERGENCE_H
+
+#include "error_norms.h"
+#include "thread_pool.h"
+#include <vector>
+
+struct convergence_level {
+    int n;
+    fit_errors errors;
+    // log2 of the ratio of the previous level's error to this one's, as h
+    // halves between levels; 0 on the first level.
+    fit_errors orders;
+};
+
+// Fits func_id on nested uniform grids of [a, b] with (n0 - 1) * 2^k + 1
+// nodes, k = 0, 1, ... while n <= max_n, and measures both methods at
+// points_per_segment points per segment (rounded up to a power of two).
+// f is evaluated once per sample point of the finest level; every coarser
+// grid, and its sample points, is a subset of those, so one pass over the
+// finest samples in blocks measures all levels, with no stored sample
+// array. The levels are fitted in parallel and the pass is split into
+// tasks for the pool. Returns false when func_id is unknown or n0 < 2 or
+// max_n < n0.
+bool convergence_study(thread_pool &pool, double a, double b, int n0,
+                       int max_n, int func_id, int points_per_segment,
+                       std::vector<convergence_level> &levels);
+
+#endif // CONVERGENCE_H
@@ -0,0 +1,134 @@
+#include "cubic_kernel.h"
+#include <climits>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CUBIC_KERNEL_X86
+#include <immintrin.h>
+#endif
+
+typedef void (*cubic_eval_fn)(const cubic_view &, const int *, const double *,
+                              double *, size_t);
+
+static void cubic_eval_scalar(const cubic_view &v, const int *seg,
+                              const double *xs, double *out, size_t count)
+{
+    for (size_t k = 0; k < count; k++) {
+        size_t i = static_cast<size_t>(seg[k]) * v.stride;
+        double t = (xs[k] - v.x_left[i]) * v.inv_h[i];
+        out[k] = v.c0[i] + t * (v.c1[i] + t * (v.c2[i] + t * v.c3[i]));
+    }
+}
+
+#ifdef CUBIC_KERNEL_X86
+// The kernels clear the upper vector halves themselves before the scalar
+// tail: GCC does not insert vzeroupper before that tail call, and the
+// dirty state would make every following SSE instruction, such as those
+// in libm's exp, pay a transition penalty.
+//
+// The masked gathers with an explicit zero source are used instead of the
+// plain ones, whose undefined source register trips -Wmaybe-uninitialized.
+__attribute__((target("avx2"))) static inline __m256d
+gather4(const double *base, __m128i i)
+{
+    __m256d mask = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+    return _mm256_mask_i32gather_pd(_mm256_setzero_pd(), base, i, mask, 8);
+}
+
+__attribute__((target("avx512f"))) static inline __m512d
+gather8(const double *base, __m256i i)
+{
+    return _mm512_mask_i32gather_pd(_mm512_setzero_pd(), 0xff, i, base, 8);
+}
+
+__attribute__((target("avx2,fma"))) static void
+cubic_eval_avx2(const cubic_view &v, const int *seg, const double *xs,
+                double *out, size_t count)
+{
+    __m128i stride = _mm_set1_epi32(v.stride);
+    size_t k = 0;
+    for (; k + 4 <= count; k += 4) {
+        __m128i i = _mm_mullo_epi32(
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(seg + k)),
+            stride);
+
+        __m256d t = _mm256_mul_pd(
+            _mm256_sub_pd(_mm256_loadu_pd(xs + k), gather4(v.x_left, i)),
+            gather4(v.inv_h, i));
+        __m256d y = gather4(v.c3, i);
+        y = _mm256_fmadd_pd(y, t, gather4(v.c2, i));
+        y = _mm256_fmadd_pd(y, t, gather4(v.c1, i));
+        y = _mm256_fmadd_pd(y, t, gather4(v.c0, i));
+        _mm256_storeu_pd(out + k, y);
+    }
+    _mm256_zeroupper();
+    cubic_eval_scalar(v, seg + k, xs + k, out + k, count - k);
+}
+
+__attribute__((target("avx512f"))) static void
+cubic_eval_avx512(const cubic_view &v, const int *seg, const double *xs,
+                  double *out, size_t count)
+{
+    __m256i stride = _mm256_set1_epi32(v.stride);
+    size_t k = 0;
+    for (; k + 8 <= count; k += 8) {
+        __m256i i = _mm256_mullo_epi32(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(seg + k)),
+            stride);
+
+        __m512d t = _mm512_mul_pd(
+            _mm512_sub_pd(_mm512_loadu_pd(xs + k), gather8(v.x_left, i)),
+            gather8(v.inv_h, i));
+        __m512d y = gather8(v.c3, i);
+        y = _mm512_fmadd_pd(y, t, gather8(v.c2, i));
+        y = _mm512_fmadd_pd(y, t, gather8(v.c1, i));
+        y = _mm512_fmadd_pd(y, t, gather8(v.c0, i));
+        _mm512_storeu_pd(out + k, y);
+    }
+    _mm256_zeroupper();
+    cubic_eval_scalar(v, seg + k, xs + k, out + k, count - k);
+}
+#endif
+
+static cubic_eval_fn select_kernel()
+{
+#ifdef CUBIC_KERNEL_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return cubic_eval_avx512;
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return cubic_eval_avx2;
+    }
+#endif
+    return cubic_eval_scalar;
+}
+
+static cubic_eval_fn kernel()
+{
+    static const cubic_eval_fn selected = select_kernel();
+    return selected;
+}
+
+void cubic_eval(const cubic_view &view, const int *seg, const double *xs,
+                double *out, size_t count)
+{
+    // Gather indices are 32-bit.
+    if (view.count * view.stride > static_cast<size_t>(INT_MAX)) {
+        cubic_eval_scalar(view, seg, xs, out, count);
+        return;
+    }
+    kernel()(view, seg, xs, out, count);
+}
+
+const char *cubic_eval_isa()
+{
+#ifdef CUBIC_KERNEL_X86
+    if (kernel() == cubic_eval_avx512) {
+        return "avx512";
+    }
+    if (kernel() == cubic_eval_avx2) {
+        return "avx2";
+    }
+#endif
+    return "scalar";
+}
@@ -0,0 +1,37 @@
+#ifndef CUBIC_KERNEL_H
+#define CUBIC_KERNEL_H
+
+#include <cstddef>
+
+// Strided view of count per-segment cubic records. Field j of segment i is
+// read from field_j[i * stride]; stride is 1 for separate arrays and the
+// record size in doubles for interleaved records.
+struct cubic_view {
+    const double *x_left;
+    const double *inv_h;
+    const double *c0;
+    const double *c1;
+    const double *c2;
+    const double *c3;
+    int stride;
+    size_t count;
+};
+
+// Value of segment i at x.
+inline double cubic_value(const cubic_view &view, int i, double x)
+{
+    size_t j = static_cast<size_t>(i) * view.stride;
+    double t = (x - view.x_left[j]) * view.inv_h[j];
+    return view.c0[j] +
+           t * (view.c1[j] + t * (view.c2[j] + t * view.c3[j]));
+}
+
+// Evaluates out[k] = c0 + c1 * t + c2 * t^2 + c3 * t^3 of segment i = seg[k]
+// at t = (xs[k] - x_left) * inv_h. The widest kernel the CPU supports
+// (AVX-512, AVX2 or scalar) is picked once at the first call, and
+// cubic_eval_isa() names it.
+void cubic_eval(const cubic_view &view, const int *seg, const double *xs,
+                double *out, size_t count);
+const char *cubic_eval_isa();
+
+#endif // CUBIC_KERNEL_H
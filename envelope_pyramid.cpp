@@ -0,0 +1,177 @@
+#include "envelope_pyramid.h"
+#include <cmath>
+
+// Extends y_min, y_max by the extrema of c0 + c1 t + c2 t^2 + c3 t^3 on
+// [t0, t1]: the end points and the roots of the derivative inside.
+static void cubic_range(const double c[4], double t0, double t1,
+                        double &y_min, double &y_max)
+{
+    double ts[4] = {t0, t1, 0., 0.};
+    int count = 2;
+
+    if (c[3] != 0.) {
+        double disc = c[2] * c[2] - 3. * c[1] * c[3];
+        if (disc >= 0.) {
+            double q = -(c[2] + std::copysign(std::sqrt(disc), c[2]));
+            if (q != 0.) {
+                ts[count++] = q / (3. * c[3]);
+                ts[count++] = c[1] / q;
+            } else {
+                ts[count++] = 0.;
+            }
+        }
+    } else if (c[2] != 0.) {
+        ts[count++] = -c[1] / (2. * c[2]);
+    }
+
+    for (int k = 0; k < count; k++) {
+        double t = ts[k];
+        if (t < t0 || t > t1) {
+            continue;
+        }
+        double y = c[0] + t * (c[1] + t * (c[2] + t * c[3]));
+        y_min = std::fmin(y_min, y);
+        y_max = std::fmax(y_max, y);
+    }
+}
+
+int envelope_pyramid::find_segment(double x) const
+{
+    int l = 0;
+    int r = size() - 1;
+    while (l < r) {
+        int m = l + (r - l + 1) / 2;
+        if (view.x_left[static_cast<size_t>(m) * view.stride] <= x) {
+            l = m;
+        } else {
+            r = m - 1;
+        }
+    }
+    return l;
+}
+
+void envelope_pyramid::segment_range(int i, double t0, double t1,
+                                     double &y_min, double &y_max) const
+{
+    size_t j = static_cast<size_t>(i) * view.stride;
+    double c[4] = {view.c0[j], view.c1[j], view.c2[j], view.c3[j]};
+    cubic_range(c, t0, t1, y_min, y_max);
+}
+
+void envelope_pyramid::segments_range(int first, int last, double &y_min,
+                                      double &y_max) const
+{
+    // Whole segments [first, last); ragged ends are scanned one by one up
+    // to the nearest leaf block boundary.
+    int l = (first + leaf_size - 1) / leaf_size;
+    int r = last / leaf_size;
+    if (l >= r) {
+        for (int i = first; i < last; i++) {
+            segment_range(i, 0., 1., y_min, y_max);
+        }
+        return;
+    }
+    for (int i = first; i < l * leaf_size; i++) {
+        segment_range(i, 0., 1., y_min, y_max);
+    }
+    for (int i = r * leaf_size; i < last; i++) {
+        segment_range(i, 0., 1., y_min, y_max);
+    }
+
+    for (size_t k = 0; l < r; k++, l /= 2, r /= 2) {
+        if (l & 1) {
+            y_min = std::fmin(y_min, lows[k][l]);
+            y_max = std::fmax(y_max, highs[k][l]);
+            l++;
+        }
+        if (r & 1) {
+            r--;
+            y_min = std::fmin(y_min, lows[k][r]);
+            y_max = std::fmax(y_max, highs[k][r]);
+        }
+    }
+}
+
+void envelope_pyramid::build(const cubic_view &coeffs)
+{
+    view = coeffs;
+    lows.clear();
+    highs.clear();
+
+    int blocks = (size() + leaf_size - 1) / leaf_size;
+    if (blocks == 0) {
+        return;
+    }
+
+    lows.emplace_back(blocks);
+    highs.emplace_back(blocks);
+    for (int j = 0; j < blocks; j++) {
+        double y_min = HUGE_VAL;
+        double y_max = -HUGE_VAL;
+        int last = j * leaf_size + leaf_size;
+        if (last > size()) {
+            last = size();
+        }
+        for (int i = j * leaf_size; i < last; i++) {
+            segment_range(i, 0., 1., y_min, y_max);
+        }
+        lows[0][j] = y_min;
+        highs[0][j] = y_max;
+    }
+
+    while (blocks > 1) {
+        const std::vector<double> &low = lows.back();
+        const std::vector<double> &high = highs.back();
+        int half = (blocks + 1) / 2;
+        std::vector<double> next_low(half);
+        std::vector<double> next_high(half);
+        for (int j = 0; j < half; j++) {
+            next_low[j] = low[2 * j];
+            next_high[j] = high[2 * j];
+            if (2 * j + 1 < blocks) {
+                next_low[j] = std::fmin(next_low[j], low[2 * j + 1]);
+                next_high[j] = std::fmax(next_high[j], high[2 * j + 1]);
+            }
+        }
+        lows.push_back(std::move(next_low));
+        highs.push_back(std::move(next_high));
+        blocks = half;
+    }
+}
+
+void envelope_pyramid::range(double x0, double x1, double &y_min,
+                             double &y_max) const
+{
+    if (size() == 0) {
+        return;
+    }
+
+    int i0 = find_segment(x0);
+    int i1 = find_segment(x1);
+    size_t j0 = static_cast<size_t>(i0) * view.stride;
+    size_t j1 = static_cast<size_t>(i1) * view.stride;
+    double t0 = (x0 - view.x_left[j0]) * view.inv_h[j0];
+    double t1 = (x1 - view.x_left[j1]) * view.inv_h[j1];
+
+    if (i0 == i1) {
+        segment_range(i0, t0, t1, y_min, y_max);
+        return;
+    }
+    segment_range(i0, t0, 1., y_min, y_max);
+    segment_range(i1, 0., t1, y_min, y_max);
+    segments_range(i0 + 1, i1, y_min, y_max);
+}
+
+void envelope_pyramid::envelope(double a, double b, int columns,
+                                double *lows, double *highs) const
+{
+    double delta_x = (b - a) / columns;
+    for (int c = 0; c < columns; c++) {
+        double y_min = HUGE_VAL;
+        double y_max = -HUGE_VAL;
+        double x1 = c + 1 == columns ? b : a + (c + 1) * delta_x;
+        range(a + c * delta_x, x1, y_min, y_max);
+        lows[c] = y_min;
+        highs[c] = y_max;
+    }
+}
@@ -0,0 +1,45 @@
+#ifndef ENVELOPE_PYRAMID_H
+#define ENVELOPE_PYRAMID_H
+
+#include "cubic_kernel.h"
+#include <cstddef>
+#include <vector>
+
+// Exact min/max envelope of a piecewise cubic over any x range. Level 0
+// holds the extrema of blocks of leaf_size segments, every further level
+// halves the block count, so a range of segments is covered by O(log n)
+// blocks plus at most two partial blocks and two partial segments. The
+// coefficients are borrowed from view and must outlive the pyramid.
+class envelope_pyramid
+{
+  private:
+    cubic_view view = {};
+    // lows[k][j], highs[k][j]: extrema of segments
+    // [j * leaf_size * 2^k, (j + 1) * leaf_size * 2^k).
+    std::vector<std::vector<double>> lows;
+    std::vector<std::vector<double>> highs;
+
+    int find_segment(double x) const;
+    void segment_range(int i, double t0, double t1, double &y_min,
+                       double &y_max) const;
+    void segments_range(int first, int last, double &y_min,
+                        double &y_max) const;
+
+  public:
+    static const int leaf_size = 16;
+
+    envelope_pyramid() = default;
+    ~envelope_pyramid() = default;
+
+    void build(const cubic_view &coeffs);
+    int size() const { return static_cast<int>(view.count); }
+
+    // Extends y_min, y_max by the extrema of the curve on [x0, x1].
+    void range(double x0, double x1, double &y_min, double &y_max) const;
+    // lows[c], highs[c]: extrema on the c-th of columns equal parts of
+    // [a, b].
+    void envelope(double a, double b, int columns, double *lows,
+                  double *highs) const;
+};
+
+#endif // ENVELOPE_PYRAMID_H
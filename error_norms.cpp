@@ -0,0 +1,86 @@
+#include "error_norms.h"
+#include "parallel_evaluate.h"
+#include "test_functions.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+struct task_sums {
+    error_sums bessel;
+    error_sums spline;
+};
+
+bool measure_errors(thread_pool &pool, const interpolation_view &view,
+                    int points_per_segment, fit_errors &errors,
+                    const std::atomic<bool> *cancel)
+{
+    const test_function *fn = find_function(view.func_id);
+    if (!fn || view.n < 2) {
+        return false;
+    }
+
+    int points = points_per_segment > 0 ? points_per_segment : 1;
+    size_t segments = static_cast<size_t>(view.n) - 1;
+    size_t task_segments = default_evaluate_grain / points;
+    task_segments = task_segments > 0 ? task_segments : 1;
+    size_t tasks = (segments + task_segments - 1) / task_segments;
+    bool spline_fitted = fabs(view.x[1] - view.x[0]) > view.eps;
+    std::vector<task_sums> sums(tasks);
+
+    pool.run(tasks, [&](size_t task) {
+        if (cancel && cancel->load(std::memory_order_relaxed)) {
+            return;
+        }
+
+        const size_t block_size = 256;
+        int seg[block_size];
+        double xs[block_size];
+        double w[block_size];
+        double exact[block_size];
+        double approx[block_size];
+        task_sums &s = sums[task];
+
+        size_t first = task * task_segments;
+        size_t last = first + task_segments < segments ? first + task_segments
+                                                       : segments;
+        size_t len = 0;
+        for (size_t i = first; i < last; i++) {
+            double h = (view.x[i + 1] - view.x[i]) / points;
+            for (int j = 0; j < points; j++) {
+                seg[len] = static_cast<int>(i);
+                xs[len] = view.x[i] + (j + 0.5) * h;
+                w[len] = h;
+                len++;
+
+                bool flush = len == block_size ||
+                             (i + 1 == last && j + 1 == points);
+                if (!flush) {
+                    continue;
+                }
+                fn->values(xs, exact, len);
+                cubic_eval(view.bessel_coeffs, seg, xs, approx, len);
+                s.bessel.add(exact, approx, w, len);
+                if (spline_fitted) {
+                    cubic_eval(view.spline_coeffs, seg, xs, approx, len);
+                } else {
+                    std::fill(approx, approx + len, 0.);
+                }
+                s.spline.add(exact, approx, w, len);
+                len = 0;
+            }
+        }
+    });
+
+    if (cancel && cancel->load(std::memory_order_relaxed)) {
+        return false;
+    }
+
+    task_sums total;
+    for (const task_sums &s : sums) {
+        total.bessel.merge(s.bessel);
+        total.spline.merge(s.spline);
+    }
+    errors.bessel = total.bessel.norms();
+    errors.spline = total.spline.norms();
+    return true;
+}
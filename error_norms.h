@@ -0,0 +1,87 @@
+#ifndef ERROR_NORMS_H
+#define ERROR_NORMS_H
+
+#include "interpolation_view.h"
+#include "thread_pool.h"
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+
+const int default_norm_points = 16;
+
+// Error of one method against its function on [x[0], x[n - 1]]: the
+// largest |f - p| at the sample points and the L2 norm
+// sqrt(integral (f - p)^2 dx) by the midpoint rule on the same points.
+struct error_norms {
+    double max_error = 0.;
+    double l2_error = 0.;
+};
+
+const int error_lanes = 4;
+
+// Running max |e| and sum of w e^2 of one method, split over error_lanes
+// independent accumulators so the compiler may keep them in one vector.
+// Merging partial sums in a fixed order keeps the result independent of
+// how the points were divided between threads.
+struct error_sums {
+    double max_error[error_lanes] = {};
+    double squares[error_lanes] = {};
+
+    void add(const double *exact, const double *approx, const double *w,
+             size_t count)
+    {
+        size_t k = 0;
+        for (; k + error_lanes <= count; k += error_lanes) {
+            for (int j = 0; j < error_lanes; j++) {
+                double e = fabs(exact[k + j] - approx[k + j]);
+                max_error[j] = e > max_error[j] ? e : max_error[j];
+                squares[j] += w[k + j] * e * e;
+            }
+        }
+        for (int j = 0; k < count; k++, j++) {
+            double e = fabs(exact[k] - approx[k]);
+            max_error[j] = e > max_error[j] ? e : max_error[j];
+            squares[j] += w[k] * e * e;
+        }
+    }
+
+    void merge(const error_sums &other)
+    {
+        for (int j = 0; j < error_lanes; j++) {
+            max_error[j] = fmax(max_error[j], other.max_error[j]);
+            squares[j] += other.squares[j];
+        }
+    }
+
+    error_norms norms() const
+    {
+        error_norms result;
+        double sum = 0.;
+        for (int j = 0; j < error_lanes; j++) {
+            result.max_error = fmax(result.max_error, max_error[j]);
+            sum += squares[j];
+        }
+        result.l2_error = sqrt(sum);
+        return result;
+    }
+};
+
+struct fit_errors {
+    error_norms bessel;
+    error_norms spline;
+};
+
+// Samples points_per_segment midpoints of equal subintervals in every
+// segment, so nonuniform grids are sampled as densely as their nodes.
+// Segments are split into tasks for the pool; each task evaluates its
+// points in blocks through the vectorized cubic kernel and the function's
+// batch loop and keeps four partial sums and maxima per method, and the
+// partial results are combined in task order, so the result does not
+// depend on the number of threads. Returns false, leaving errors
+// unchanged, when the view has no registered function or fewer than two
+// nodes, or when *cancel is set before the end.
+bool measure_errors(thread_pool &pool, const interpolation_view &view,
+                    int points_per_segment, fit_errors &errors,
+                    const std::atomic<bool> *cancel = nullptr);
+
+#endif // ERROR_NORMS_H
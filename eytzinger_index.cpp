@@ -0,0 +1,47 @@
+#include "eytzinger_index.h"
+
+// In-order walk of the implicit tree, so the keys land in sorted order.
+void eytzinger_index::fill(const double *x, int &next, int k)
+{
+    if (k > keys) {
+        return;
+    }
+    fill(x, next, 2 * k);
+    lines[k / 8].key[k % 8] = x[next + 1];
+    rank[k] = next;
+    next++;
+    fill(x, next, 2 * k + 1);
+}
+
+void eytzinger_index::build(const double *x, int n)
+{
+    keys = n > 2 ? n - 2 : 0;
+    lines.assign(keys / 8 + 1, key_line());
+    rank.assign(keys + 1, 0);
+
+    int next = 0;
+    fill(x, next, 1);
+}
+
+void eytzinger_index::clear()
+{
+    keys = 0;
+    std::vector<key_line>().swap(lines);
+    std::vector<int>().swap(rank);
+}
+
+int eytzinger_index::find(double new_x) const
+{
+    const double *slot = key_slots();
+    int k = 1;
+    while (k <= keys) {
+        // Slots 8k .. 8k + 7; past the end the prefetch is simply dropped.
+        __builtin_prefetch(slot + 8 * static_cast<long>(k));
+        k = 2 * k + (slot[k] <= new_x);
+    }
+
+    // Undo the right turns taken after the last left turn: that left turn
+    // was at the first key greater than new_x.
+    k >>= __builtin_ffs(~k);
+    return k == 0 ? keys : rank[k];
+}
@@ -0,0 +1,42 @@
+#ifndef EYTZINGER_INDEX_H
+#define EYTZINGER_INDEX_H
+
+#include <vector>
+
+// Segment lookup over sorted nodes x[0] < ... < x[n - 1] with the inner
+// nodes x[1] .. x[n - 2] stored in Eytzinger (breadth-first) order: the
+// children of slot k are 2k and 2k + 1. The search is branch free, and the
+// eight slots three levels below k share one cache line that is prefetched
+// while the current level is compared, so a lookup in a large grid waits
+// on a few memory loads instead of one per halving step.
+class eytzinger_index
+{
+  private:
+    struct alignas(64) key_line {
+        double key[8];
+    };
+
+    int keys = 0;
+    // Slot 0 is unused, so the descendants of slot k at depth 3 are the
+    // aligned slots 8k .. 8k + 7.
+    std::vector<key_line> lines;
+    // Position of the key in slot k among x[1] .. x[n - 2].
+    std::vector<int> rank;
+
+    const double *key_slots() const { return lines.data()->key; }
+    void fill(const double *x, int &next, int k);
+
+  public:
+    eytzinger_index() = default;
+    ~eytzinger_index() = default;
+
+    void build(const double *x, int n);
+    void clear();
+    bool empty() const { return lines.empty(); }
+
+    // Same result as interpolation_view::binary_search: the segment
+    // [x[i], x[i + 1]] holding new_x, clamped to [0, n - 2].
+    int find(double new_x) const;
+};
+
+#endif // EYTZINGER_INDEX_H
@@ -1,124 +1,203 @@
 #include "interpolation.h"
+#include "stats.h"
+#include "test_functions.h"
+#include "tridiagonal.h"
+#include <algorithm>
 #include <cmath>
 
-double func(int func_id, double x)
-{
-    switch (func_id) {
-    case 0:
-        return 1.;
-    case 1:
-        return x;
-    case 2:
-        return x * x;
-    case 3:
-        return x * x * x;
-    case 4:
-        return x * x * x * x;
-    case 5:
-        return exp(x);
-    case 6:
-        return 1. / (25. * x * x + 1.);
-    default:
-        return 0.;
+// A set *cancel stops the fit between its passes, leaving the object
+// incomplete; the caller that raised the flag is expected to discard it.
+interpolation::interpolation(double new_a, double new_b, int new_n,
+                             int new_func_id, const std::atomic<bool> *cancel)
+{
+    a = new_a;
+    b = new_b;
+    n = new_n;
+    func_id = new_func_id;
+    disturb = 0;
+    STATS_COUNT(stat_counter::refit_construct, 1);
+
+    resize_nodes();
+    build_uniform_grid();
+    fill_values();
+    if (cancel && cancel->load(std::memory_order_relaxed)) {
+        return;
     }
-}
 
-double func_2derivative(int func_id, double x)
-{
-    switch (func_id) {
-    case 0:
-        return 0.;
-    case 1:
-        return 0.;
-    case 2:
-        return 2.;
-    case 3:
-        return 6. * x;
-    case 4:
-        return 12. * x * x;
-    case 5:
-        return exp(x);
-    case 6:
-        return -50. / (25. * x * x + 1.) / (25. * x * x + 1.) +
-               5000 * x * x / (25. * x * x + 1.) / (25. * x * x + 1.) /
-                   (25. * x * x + 1.);
-    }
-    return 0.;
+    update_bessel_coeffs();
+    if (cancel && cancel->load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    update_spline_coeffs();
 }
 
 interpolation::interpolation(double new_a, double new_b, int new_n,
-                             int new_func_id)
+                             int new_func_id,
+                             const std::vector<double> &values)
 {
     a = new_a;
     b = new_b;
     n = new_n;
     func_id = new_func_id;
-    disturb = 0;
+    STATS_COUNT(stat_counter::refit_construct, 1);
+
+    resize_nodes();
+    build_uniform_grid();
+    std::copy(values.begin(), values.begin() + n, f_x.begin());
+
+    update_bessel_coeffs();
+    update_spline_coeffs();
+}
+
+interpolation::interpolation(const std::vector<double> &nodes,
+                             int new_func_id)
+{
+    func_id = new_func_id;
+    STATS_COUNT(stat_counter::refit_construct, 1);
+
+    set_nodes(nodes);
+    fill_values();
+
+    update_bessel_coeffs();
+    update_spline_coeffs();
+}
+
+interpolation::interpolation(const std::vector<double> &nodes,
+                             const std::vector<double> &values)
+{
+    func_id = data_func_id;
+    STATS_COUNT(stat_counter::refit_construct, 1);
+
+    set_nodes(nodes);
+    std::copy(values.begin(), values.begin() + n, f_x.begin());
 
+    update_bessel_coeffs();
+    update_spline_coeffs();
+}
+
+void interpolation::resize_nodes()
+{
     x.resize(n);
     f_x.resize(n);
     d.resize(n);
-    bessel_coeffs.resize(4 * (n - 1));
-    spline_coeffs.resize(4 * (n - 1));
+    spline_d.resize(n);
+    bessel_coeffs.resize(n - 1);
+    spline_coeffs.resize(n - 1);
+}
 
-    double step = (b - a) / (n - 1);
+void interpolation::build_uniform_grid()
+{
+    step = (b - a) / (n - 1);
+    uniform = true;
+    grid_version++;
+    search_index.clear();
     for (int i = 0; i < n; i++) {
         x[i] = a + i * step;
-        f_x[i] = func(func_id, a + i * step);
     }
+}
 
-    update_bessel_coeffs();
-    update_spline_coeffs();
+void interpolation::set_nodes(const std::vector<double> &nodes)
+{
+    n = static_cast<int>(nodes.size());
+    resize_nodes();
+    std::copy(nodes.begin(), nodes.end(), x.begin());
+
+    a = x[0];
+    b = x[n - 1];
+    step = (b - a) / (n - 1);
+    uniform = false;
+    grid_version++;
+    search_index.build(x.data(), n);
 }
 
-void interpolation::update_bessel_coeffs()
+// Width of segment i; the nodes of a uniform grid are a + i * step.
+double interpolation::interval(int i) const
+{
+    return uniform ? step : x[i + 1] - x[i];
+}
+
+// f'' at end node i for the Bessel end slopes. Sampled data have no
+// derivative, so it is estimated by the second divided difference of the
+// three outermost nodes.
+double interpolation::end_second_derivative(int i) const
+{
+    if (find_function(func_id)) {
+        return func_2derivative(func_id, x[i]);
+    }
+    if (n < 3) {
+        return 0.;
+    }
+
+    int j = i == 0 ? 0 : n - 3;
+    double h0 = x[j + 1] - x[j];
+    double h1 = x[j + 2] - x[j + 1];
+    return 2. * ((f_x[j + 2] - f_x[j + 1]) / h1 - (f_x[j + 1] - f_x[j]) / h0) /
+           (h0 + h1);
+}
+
+void interpolation::fill_values()
+{
+    const test_function *fn = find_function(func_id);
+    if (fn) {
+        fn->values(x.data(), f_x.data(), n);
+    } else {
+        std::fill(f_x.begin(), f_x.end(), 0.);
+    }
+}
+
+double interpolation::bessel_slope(int i) const
 {
     double tmp1;
     double tmp2;
 
-    for (int i = 1; i < n - 1; i++) {
-        tmp1 = (f_x[i] - f_x[i - 1]) / (x[i] - x[i - 1]);
-        tmp2 = (f_x[i + 1] - f_x[i]) / (x[i + 1] - x[i]);
-        d[i] = ((x[i + 1] - x[i]) * tmp1 + (x[i] - x[i - 1]) * tmp2) /
-               (x[i + 1] - x[i - 1]);
+    if (i == 0) {
+        tmp1 = (f_x[1] - f_x[0]) / (x[1] - x[0]);
+        return 0.5 * (3 * tmp1 - d[1] -
+                      0.5 * end_second_derivative(0) * (x[1] - x[0]));
+    }
+    if (i == n - 1) {
+        tmp2 = (f_x[n - 1] - f_x[n - 2]) / (x[n - 1] - x[n - 2]);
+        return 0.5 * (3 * tmp2 - d[n - 2] +
+                      0.5 * end_second_derivative(n - 1) *
+                          (x[n - 1] - x[n - 2]));
     }
 
-    tmp1 = (f_x[1] - f_x[0]) / (x[1] - x[0]);
-    tmp2 = (f_x[n - 1] - f_x[n - 2]) / (x[n - 1] - x[n - 2]);
+    tmp1 = (f_x[i] - f_x[i - 1]) / (x[i] - x[i - 1]);
+    tmp2 = (f_x[i + 1] - f_x[i]) / (x[i + 1] - x[i]);
+    return ((x[i + 1] - x[i]) * tmp1 + (x[i] - x[i - 1]) * tmp2) /
+           (x[i + 1] - x[i - 1]);
+}
 
-    d[0] = 0.5 * (3 * tmp1 - d[1] -
-                  0.5 * func_2derivative(func_id, x[0]) * (x[1] - x[0]));
-    d[n - 1] = 0.5 * (3 * tmp2 - d[n - 2] +
-                      0.5 * func_2derivative(func_id, x[n - 1]) *
-                          (x[n - 1] - x[n - 2]));
+void interpolation::set_bessel_segment(int i)
+{
+    double h = x[i + 1] - x[i];
+    double tmp = (f_x[i + 1] - f_x[i]) / h;
+    bessel_coeffs.set(i, x[i], h, f_x[i], d[i],
+                      (3 * tmp - 2 * d[i] - d[i + 1]) / h,
+                      (d[i] + d[i + 1] - 2 * tmp) / h / h);
+}
 
-    int j = 0;
+void interpolation::update_bessel_coeffs()
+{
+    STATS_TIME(stat_timer::bessel_update);
+
+    for (int i = 1; i < n - 1; i++) {
+        d[i] = bessel_slope(i);
+    }
+
+    d[0] = bessel_slope(0);
+    d[n - 1] = bessel_slope(n - 1);
 
     for (int i = 0; i < n - 1; i++) {
-        bessel_coeffs[j + 0] = f_x[i];
-        bessel_coeffs[j + 1] = d[i];
-        tmp2 = x[i + 1] - x[i];
-        tmp1 = (f_x[i + 1] - f_x[i]) / tmp2;
-        bessel_coeffs[j + 2] = (3 * tmp1 - 2 * d[i] - d[i + 1]) / tmp2;
-        tmp2 *= tmp2;
-        bessel_coeffs[j + 3] = (d[i] + d[i + 1] - 2 * tmp1) / tmp2;
-        j += 4;
+        set_bessel_segment(i);
     }
 }
 
-double interpolation::bessel(double new_x)
+double interpolation::bessel(double new_x) const
 {
-    int i;
-    for (i = 0; i < n - 2; i++) {
-        if (new_x <= x[i + 1]) {
-            break;
-        }
-    }
-
-    return bessel_coeffs[4 * i] + bessel_coeffs[4 * i + 1] * (new_x - x[i]) +
-           bessel_coeffs[4 * i + 2] * (new_x - x[i]) * (new_x - x[i]) +
-           bessel_coeffs[4 * i + 3] * (new_x - x[i]) * (new_x - x[i]) *
-               (new_x - x[i]);
+    STATS_COUNT(stat_counter::eval_bessel, 1);
+    return view().bessel(new_x);
 }
 
 void interpolation::lagrange_polynom(double *lag_x, double *lag_f_x,
@@ -144,9 +223,29 @@ double interpolation::derivative_lagrange_polynom(const double *lag_x,
                lag_f_x[3];
 }
 
+// Slope at point of the polynomial through the k <= 4 samples (lag_x,
+// lag_f_x); lag_f_x is overwritten with divided differences.
+double interpolation::end_slope(double *lag_x, double *lag_f_x, int k,
+                                double point)
+{
+    for (int j = 0; j < k - 1; j++) {
+        for (int i = k - 1; i > j; i--) {
+            lag_f_x[i] =
+                (lag_f_x[i] - lag_f_x[i - 1]) / (lag_x[i] - lag_x[i - j - 1]);
+        }
+    }
+    for (int i = k; i < 4; i++) {
+        lag_x[i] = lag_x[k - 1];
+        lag_f_x[i] = 0.;
+    }
+    return derivative_lagrange_polynom(lag_x, lag_f_x, point);
+}
+
 void interpolation::solve(std::vector<double> &d, std::vector<double> &a,
                           std::vector<double> &c, std::vector<double> &b, int n)
 {
+    STATS_TIME(stat_timer::solve);
+
     c[0] = c[0] / a[0];
 
     for (int i = 0; i < n - 2; i++) {
@@ -168,6 +267,8 @@ void interpolation::solve(std::vector<double> &d, std::vector<double> &a,
 
 void interpolation::update_spline_coeffs()
 {
+    STATS_TIME(stat_timer::spline_update);
+
     if (n > 1 && fabs(x[1] - x[0]) <= eps) {
         return;
     }
@@ -176,140 +277,167 @@ void interpolation::update_spline_coeffs()
         return;
     }
 
-    double step = (b - a) / (n - 1);
-
-    double lag_f_x[4];
-    double lag_x[4];
+    double der_Q_k = spline_end_slope(0);
+    double der_R_k = spline_end_slope(n - 1);
+
+    // The matrix depends only on the grid, so it is factored once per
+    // grid and refits only substitute.
+    if (spline_lu.size() != n || spline_lu_grid != grid_version) {
+        diag.resize(n);
+        up_diag.resize(n);
+        low_diag.resize(n);
+
+        for (int i = 0; i < n; i++) {
+            double low;
+            spline_row(i, low, diag[i], up_diag[i]);
+            if (i > 0) {
+                low_diag[i - 1] = low;
+            }
+        }
 
-    for (int i = 0; i < loc_n; i++) {
-        lag_x[i] = a + i * step;
-        lag_f_x[i] = func(func_id, lag_x[i]);
+        spline_lu.factor(low_diag, diag, up_diag, n,
+                         n >= parallel_solve_min_n ? 0 : 1);
+        spline_lu_grid = grid_version;
     }
-    lagrange_polynom(lag_x, lag_f_x, loc_n);
-    double der_Q_k = derivative_lagrange_polynom(lag_x, lag_f_x, a);
 
-    double xi = b - (loc_n - 1) * step;
-    for (int i = 0; i < loc_n; i++) {
-        lag_x[i] = xi;
-        lag_f_x[i] = func(func_id, xi);
-        xi += step;
+    spline_d[0] = der_Q_k;
+    spline_d[n - 1] = der_R_k;
+    for (int i = 1; i < n - 1; i++) {
+        spline_d[i] = spline_rhs(i);
     }
-    lagrange_polynom(lag_x, lag_f_x, loc_n);
-    double der_R_k = derivative_lagrange_polynom(lag_x, lag_f_x, b);
 
-    std::vector<double> diag;
-    std::vector<double> up_diag;
-    std::vector<double> low_diag;
-    std::vector<double> ans;
+    {
+        STATS_TIME(stat_timer::solve);
+        spline_lu.solve(spline_d.data());
+    }
 
-    diag.resize(n);
-    up_diag.resize(n);
-    low_diag.resize(n);
-    ans.resize(n);
+    for (int i = 0; i < n - 1; i++) {
+        set_spline_segment(i);
+    }
+}
 
-    diag[0] = 1.;
-    up_diag[0] = 0.;
-    ans[0] = der_Q_k;
-    ans[n - 1] = der_R_k;
+// Slope at end node i of the cubic through the loc_n outermost points. A
+// known function on a uniform grid is sampled at a + k * step, also past
+// the grid when n < loc_n; otherwise the cubic goes through the end nodes.
+double interpolation::spline_end_slope(int i) const
+{
+    const test_function *fn = find_function(func_id);
+    double point = i == 0 ? a : b;
+    double lag_f_x[4];
+    double lag_x[4];
 
-    for (int i = 1; i < n - 1; i++) {
-        diag[i] = 4. * step;
-        up_diag[i] = 1. * step;
-        low_diag[i - 1] = 1. * step;
-        ans[i] = 3. * (f_x[i + 1] - f_x[i - 1]);
+    if (uniform && fn) {
+        double xi = i == 0 ? a : b - (loc_n - 1) * step;
+        for (int k = 0; k < loc_n; k++) {
+            lag_x[k] = xi;
+            lag_f_x[k] = fn->value(xi);
+            xi = i == 0 ? a + (k + 1) * step : xi + step;
+        }
+        lagrange_polynom(lag_x, lag_f_x, loc_n);
+        return derivative_lagrange_polynom(lag_x, lag_f_x, point);
     }
 
-    diag[n - 1] = 1.;
-    low_diag[n - 2] = 0.;
-
-    solve(low_diag, diag, up_diag, ans, n);
+    int k = loc_n < n ? loc_n : n;
+    int first = i == 0 ? 0 : n - k;
+    for (int j = 0; j < k; j++) {
+        lag_x[j] = x[first + j];
+        lag_f_x[j] = fn ? fn->value(lag_x[j]) : f_x[first + j];
+    }
+    return end_slope(lag_x, lag_f_x, k, point);
+}
 
-    for (int i = 0; i < n - 1; i++) {
-        spline_coeffs[4 * i + 0] = f_x[i];
-        spline_coeffs[4 * i + 1] = ans[i];
-        spline_coeffs[4 * i + 2] =
-            ((f_x[i + 1] - f_x[i]) / step - ans[i]) / step;
-        spline_coeffs[4 * i + 3] =
-            (ans[i] + ans[i + 1] - 2. * (f_x[i + 1] - f_x[i]) / step) / step /
-            step;
+// Row i of the slope system:
+//     h1 * s[i - 1] + 2 (h0 + h1) * s[i] + h0 * s[i + 1]
+//         = 3 (h1 * (f[i] - f[i - 1]) / h0 + h0 * (f[i + 1] - f[i]) / h1)
+// with h0 = x[i] - x[i - 1] and h1 = x[i + 1] - x[i]; on a uniform grid
+// the right-hand side is 3 (f[i + 1] - f[i - 1]). The end rows pin s[0] and
+// s[n - 1] to the Lagrange derivative estimates.
+void interpolation::spline_row(int i, double &low, double &diag,
+                               double &up) const
+{
+    if (i == 0 || i == n - 1) {
+        low = 0.;
+        diag = 1.;
+        up = 0.;
+        return;
     }
+
+    double h0 = interval(i - 1);
+    double h1 = interval(i);
+    low = h1;
+    diag = 2. * (h0 + h1);
+    up = h0;
 }
 
-int interpolation::binary_search(double curr_x)
+double interpolation::spline_rhs(int i) const
 {
-    int left = 0;
-    int right = n - 1;
-    int medium;
-    while (right - left > 1) {
-        medium = (left + right) / 2;
-        if (curr_x >= x[medium] && curr_x <= x[medium + 1]) {
-            return medium;
-        }
-        if (curr_x >= x[medium]) {
-            left = medium;
-        }
-        if (curr_x <= x[medium]) {
-            right = medium;
-        }
+    if (uniform) {
+        return 3. * (f_x[i + 1] - f_x[i - 1]);
     }
-    return left;
+
+    double h0 = x[i] - x[i - 1];
+    double h1 = x[i + 1] - x[i];
+    return 3. * (h1 * (f_x[i] - f_x[i - 1]) / h0 +
+                 h0 * (f_x[i + 1] - f_x[i]) / h1);
 }
 
-double interpolation::spline(double new_x)
+// Right-hand side of row i of the slope system, end rows included.
+double interpolation::spline_rhs_row(int i) const
 {
-    if (n > 1 && fabs(x[1] - x[0]) <= eps) {
-        return 0.;
+    if (i == 0 || i == n - 1) {
+        return spline_end_slope(i);
     }
+    return spline_rhs(i);
+}
 
-    int i = binary_search(new_x);
+void interpolation::set_spline_segment(int i)
+{
+    double h = interval(i);
+    double tmp = (f_x[i + 1] - f_x[i]) / h;
+    spline_coeffs.set(i, x[i], h, f_x[i], spline_d[i],
+                      (3. * tmp - 2. * spline_d[i] - spline_d[i + 1]) / h,
+                      (spline_d[i] + spline_d[i + 1] - 2. * tmp) / h / h);
+}
 
-    i = i < 0 ? 0 : i;
-    i = i > n - 2 ? n - 2 : i;
+int interpolation::binary_search(double curr_x) const
+{
+    return view().binary_search(curr_x);
+}
 
-    double tmp = new_x - x[i];
-    return spline_coeffs[4 * i] + spline_coeffs[4 * i + 1] * tmp +
-           spline_coeffs[4 * i + 2] * tmp * tmp +
-           spline_coeffs[4 * i + 3] * tmp * tmp * (new_x - x[i + 1]);
+double interpolation::spline(double new_x) const
+{
+    STATS_COUNT(stat_counter::eval_spline, 1);
+    return view().spline(new_x);
 }
 
-double interpolation::bessel_error(double x)
+double interpolation::bessel_error(double x) const
 {
-    return func(func_id, x) - bessel(x);
+    STATS_COUNT(stat_counter::eval_error_bessel, 1);
+    return view().bessel_error(x);
 }
 
-double interpolation::spline_error(double x)
+double interpolation::spline_error(double x) const
 {
-    return func(func_id, x) - spline(x);
+    STATS_COUNT(stat_counter::eval_error_spline, 1);
+    return view().spline_error(x);
 }
 
+// Without a known bound the maximum is taken over the nodes.
 double interpolation::max_value() const
 {
-    if (func_id == 0) {
-        return 1.0;
-    } else if (func_id == 5) {
-        return func(func_id, b);
-    } else if (func_id == 6) {
-        if (a * b < 0) {
-            return func(func_id, 0);
-        }
-        double max_val;
-        if (fabs(a) < fabs(b)) {
-            max_val = fabs(func(func_id, a));
-        } else {
-            max_val = fabs(func(func_id, b));
-        }
-
-        return max_val;
-    } else {
-        double max_val;
-        if (fabs(a) > fabs(b)) {
-            max_val = fabs(func(func_id, a));
-        } else {
-            max_val = fabs(func(func_id, b));
-        }
+    const test_function *fn = find_function(func_id);
+    if (!fn) {
+        return 0.;
+    }
+    if (fn->max_abs) {
+        return fn->max_abs(a, b);
+    }
 
-        return max_val;
+    double max_val = 0.;
+    for (int i = 0; i < n; i++) {
+        max_val = std::max(max_val, fabs(fn->value(x[i])));
     }
+    return max_val;
 }
 
 void interpolation::change_func(int new_func_id)
@@ -319,10 +447,9 @@ void interpolation::change_func(int new_func_id)
     }
 
     func_id = new_func_id;
+    STATS_COUNT(stat_counter::refit_change_func, 1);
 
-    for (int i = 0; i < n; i++) {
-        f_x[i] = func(func_id, x[i]);
-    }
+    fill_values();
 
     update_bessel_coeffs();
     update_spline_coeffs();
@@ -335,17 +462,11 @@ void interpolation::change_n(int new_n)
     }
 
     n = new_n;
-    x.resize(n);
-    f_x.resize(n);
-    d.resize(n);
-    bessel_coeffs.resize(4 * (n - 1));
-    spline_coeffs.resize(4 * (n - 1));
+    STATS_COUNT(stat_counter::refit_change_n, 1);
+    resize_nodes();
 
-    double step = (b - a) / (n - 1);
-    for (int i = 0; i < n; i++) {
-        x[i] = a + i * step;
-        f_x[i] = func(func_id, a + i * step);
-    }
+    build_uniform_grid();
+    fill_values();
 
     update_bessel_coeffs();
     update_spline_coeffs();
@@ -353,32 +474,141 @@ void interpolation::change_n(int new_n)
 
 void interpolation::increase_disturb()
 {
-    disturb++;
-    f_x[n / 2] = func(func_id, x[n / 2]) + disturb * 0.1 * max_value();
-
-    update_bessel_coeffs();
-    update_spline_coeffs();
+    set_disturb(disturb + 1);
 }
 
 void interpolation::decrease_disturb()
 {
-    disturb--;
-    f_x[n / 2] = func(func_id, x[n / 2]) + disturb * 0.1 * max_value();
+    set_disturb(disturb - 1);
+}
 
-    update_bessel_coeffs();
-    update_spline_coeffs();
+// Fits of samples keep no undisturbed value to offset, so they are left
+// as they are.
+void interpolation::set_disturb(int new_disturb)
+{
+    if (func_id == data_func_id) {
+        return;
+    }
+    disturb = new_disturb;
+    STATS_COUNT(stat_counter::refit_disturb, 1);
+    update_node(n / 2, func(func_id, x[n / 2]) + disturb * 0.1 * max_value());
+}
+
+// Replaces f_x[i] and refits only the segments that depend on it. Bessel
+// slopes use a three-point window, so at most four segments change. The
+// spline slope correction solves the slope system restricted to
+// spline_update_width nodes on each side of the changed rows: entries of
+// the inverse of the diagonally dominant spline matrix decay at least like
+// 2^-k away from the diagonal, so the truncation stays below rounding
+// error.
+void interpolation::update_node(int i, double value)
+{
+    if (i < 0 || i >= n) {
+        return;
+    }
+    STATS_COUNT(stat_counter::node_update, 1);
+
+    if (n < n_spline_min) {
+        f_x[i] = value;
+        update_bessel_coeffs();
+        update_spline_coeffs();
+        return;
+    }
+
+    // Rows i - 1 and i + 1 of the spline right-hand side contain f_x[i],
+    // and so does row i on a nonuniform grid. The end rows pin the slopes
+    // to cubics through the loc_n outermost nodes, which for data fits
+    // read f_x too.
+    int rows[5];
+    int row_count = 0;
+    if (i < loc_n) {
+        rows[row_count++] = 0;
+    }
+    for (int r = i - 1; r <= i + 1; r++) {
+        if (r >= 1 && r <= n - 2) {
+            rows[row_count++] = r;
+        }
+    }
+    if (i >= n - loc_n) {
+        rows[row_count++] = n - 1;
+    }
+
+    double delta[5];
+    for (int k = 0; k < row_count; k++) {
+        delta[k] = -spline_rhs_row(rows[k]);
+    }
+
+    f_x[i] = value;
+
+    for (int k = 0; k < row_count; k++) {
+        delta[k] += spline_rhs_row(rows[k]);
+    }
+
+    int lo = i - 1 < 1 ? 1 : i - 1;
+    int hi = i + 1 > n - 2 ? n - 2 : i + 1;
+    for (int j = lo; j <= hi; j++) {
+        d[j] = bessel_slope(j);
+    }
+    if (i <= 2) {
+        d[0] = bessel_slope(0);
+    }
+    if (i >= n - 3) {
+        d[n - 1] = bessel_slope(n - 1);
+    }
+
+    lo = i - 2 < 0 ? 0 : i - 2;
+    hi = i + 1 > n - 2 ? n - 2 : i + 1;
+    for (int j = lo; j <= hi; j++) {
+        set_bessel_segment(j);
+    }
+
+    if (fabs(x[1] - x[0]) <= eps) {
+        return;
+    }
+
+    lo = rows[0] - spline_update_width;
+    lo = lo < 0 ? 0 : lo;
+    hi = rows[row_count - 1] + spline_update_width;
+    hi = hi > n - 1 ? n - 1 : hi;
+    int m = hi - lo + 1;
+
+    diag.resize(m);
+    up_diag.resize(m);
+    low_diag.resize(m);
+    ans.assign(m, 0.);
+
+    for (int r = lo; r <= hi; r++) {
+        double low;
+        spline_row(r, low, diag[r - lo], up_diag[r - lo]);
+        if (r > lo) {
+            low_diag[r - lo - 1] = low;
+        }
+    }
+    for (int k = 0; k < row_count; k++) {
+        ans[rows[k] - lo] = delta[k];
+    }
+
+    solve(low_diag, diag, up_diag, ans, m);
+
+    for (int r = lo; r <= hi; r++) {
+        spline_d[r] += ans[r - lo];
+    }
+
+    lo = lo - 1 < 0 ? 0 : lo - 1;
+    hi = hi > n - 2 ? n - 2 : hi;
+    for (int j = lo; j <= hi; j++) {
+        set_spline_segment(j);
+    }
 }
 
 void interpolation::increase_scale()
 {
     a /= 2;
     b /= 2;
+    STATS_COUNT(stat_counter::refit_scale, 1);
 
-    double step = (b - a) / (n - 1);
-    for (int i = 0; i < n; i++) {
-        x[i] = a + i * step;
-        f_x[i] = func(func_id, a + i * step);
-    }
+    build_uniform_grid();
+    fill_values();
 
     update_bessel_coeffs();
     update_spline_coeffs();
@@ -388,30 +618,70 @@ void interpolation::decrease_scale()
 {
     a *= 2;
     b *= 2;
+    STATS_COUNT(stat_counter::refit_scale, 1);
 
-    double step = (b - a) / (n - 1);
-    for (int i = 0; i < n; i++) {
-        x[i] = a + i * step;
-        f_x[i] = func(func_id, a + i * step);
-    }
+    build_uniform_grid();
+    fill_values();
 
     update_bessel_coeffs();
     update_spline_coeffs();
 }
 
-double interpolation::get_value(double x, interpolation_method method)
+void interpolation::set_segment_layout(segment_layout layout)
 {
-    switch (method) {
-    case interpolation_method::origin:
-        return func(func_id, x);
-    case interpolation_method::bessel:
-        return bessel(x);
-    case interpolation_method::spline:
-        return spline(x);
-    case interpolation_method::error_bessel:
-        return bessel_error(x);
-    case interpolation_method::error_spline:
-        return spline_error(x);
-    }
-    return 0;
+    bessel_coeffs.set_layout(layout);
+    spline_coeffs.set_layout(layout);
+}
+
+double interpolation::get_value(double x,
+                                interpolation_method method) const
+{
+    return view().get_value(x, method);
+}
+
+void interpolation::evaluate(const double *xs, double *out, size_t count,
+                             interpolation_method method) const
+{
+    view().evaluate(xs, out, count, method);
+}
+
+interpolation_view interpolation::view() const
+{
+    interpolation_view v;
+    v.a = a;
+    v.b = b;
+    v.n = n;
+    v.func_id = func_id;
+    v.step = step;
+    v.uniform = uniform;
+    v.x = x.data();
+    v.f_x = f_x.data();
+    v.index = uniform ? nullptr : &search_index;
+    v.bessel_coeffs = bessel_coeffs.view();
+    v.spline_coeffs = spline_coeffs.view();
+    return v;
+}
+
+void interpolation::publish()
+{
+    std::shared_ptr<const interpolation_snapshot> next =
+        std::make_shared<const interpolation_snapshot>(*this);
+    std::atomic_store(&published, next);
+}
+
+std::shared_ptr<const interpolation_snapshot> interpolation::snapshot() const
+{
+    return std::atomic_load(&published);
+}
+
+interpolation_snapshot::interpolation_snapshot(const interpolation &f)
+    : x(f.x), f_x(f.f_x), index(f.search_index),
+      bessel_coeffs(f.bessel_coeffs), spline_coeffs(f.spline_coeffs),
+      v(f.view())
+{
+    v.x = x.data();
+    v.f_x = f_x.data();
+    v.index = v.uniform ? nullptr : &index;
+    v.bessel_coeffs = bessel_coeffs.view();
+    v.spline_coeffs = spline_coeffs.view();
 }
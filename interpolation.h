@@ -1,19 +1,18 @@
 #ifndef INTERPOLATION_H
 #define INTERPOLATION_H
 
+#include "eytzinger_index.h"
+#include "interpolation_view.h"
+#include "segment_table.h"
+#include "tridiagonal.h"
+#include <atomic>
 #include <cmath>
+#include <cstddef>
 #include <cstdio>
+#include <memory>
 #include <vector>
 
-enum class interpolation_method {
-    origin,
-    bessel,
-    spline,
-    error_bessel,
-    error_spline,
-};
-
-double func(int func_id, double x);
+class interpolation_snapshot;
 
 class interpolation
 {
@@ -26,28 +25,67 @@ class interpolation
     int n = 0;
     int func_id = 0;
     int disturb = 0;
+    double step = 0.;
+    bool uniform = true;
 
     std::vector<double> x;
     std::vector<double> f_x;
     std::vector<double> d;
-    std::vector<double> bessel_coeffs;
-    std::vector<double> spline_coeffs;
+    std::vector<double> spline_d;
+    segment_table bessel_coeffs;
+    segment_table spline_coeffs;
+    // Built for nonuniform grids only.
+    eytzinger_index search_index;
 
+    // Bumped whenever x changes; spline_lu is reused while it matches.
+    unsigned grid_version = 0;
+    tridiagonal_lu spline_lu;
+    unsigned spline_lu_grid = 0;
+
+    // Scratch for building and solving slope systems. Resized in place, so
+    // refits allocate only when a system outgrows every earlier one.
     std::vector<double> diag;
     std::vector<double> up_diag;
     std::vector<double> low_diag;
     std::vector<double> ans;
 
+    std::shared_ptr<const interpolation_snapshot> published;
+
+    void resize_nodes();
+    void build_uniform_grid();
+    void set_nodes(const std::vector<double> &nodes);
+    void fill_values();
+    double interval(int i) const;
+    double end_second_derivative(int i) const;
+    double bessel_slope(int i) const;
+    void set_bessel_segment(int i);
     void update_bessel_coeffs();
+    double spline_end_slope(int i) const;
+    void spline_row(int i, double &low, double &diag, double &up) const;
+    double spline_rhs(int i) const;
+    double spline_rhs_row(int i) const;
+    void set_spline_segment(int i);
     void update_spline_coeffs();
     static void solve(std::vector<double> &d, std::vector<double> &a,
                       std::vector<double> &c, std::vector<double> &b, int n);
 
   public:
     int loc_n = 4;
-    const int n_bessel_max = 50;
     const int n_spline_min = 3;
-    interpolation(double a, double b, int n, int func_id);
+    const int spline_update_width = 64;
+    static const int parallel_solve_min_n = 1 << 18;
+    interpolation(double a, double b, int n, int func_id,
+                  const std::atomic<bool> *cancel = nullptr);
+    // Fits func_id on the uniform grid from values[i] = f(a + i * step)
+    // computed beforehand.
+    interpolation(double a, double b, int n, int func_id,
+                  const std::vector<double> &values);
+    // Fits on strictly increasing nodes, n >= 2, either the function func_id
+    // or the samples values[i] at nodes[i] (func_id is then data_func_id).
+    // change_n and the scale changes go back to a uniform grid.
+    interpolation(const std::vector<double> &nodes, int func_id);
+    interpolation(const std::vector<double> &nodes,
+                  const std::vector<double> &values);
     ~interpolation() = default;
 
     double max_value() const;
@@ -55,20 +93,61 @@ class interpolation
     void change_func(int func_id);
     void increase_disturb();
     void decrease_disturb();
+    // Moves the middle node by disturb * 0.1 * max_value() off the function;
+    // a no-op for fits of samples.
+    void set_disturb(int disturb);
+    void update_node(int i, double value);
     void increase_scale();
     void decrease_scale();
+    void set_segment_layout(segment_layout layout);
 
-    double bessel(double x);
-    double bessel_error(double x);
+    double bessel(double x) const;
+    double bessel_error(double x) const;
 
-    int binary_search(double x);
+    int binary_search(double x) const;
     void lagrange_polynom(double *lag_x, double *lag_f_x, int k) const;
     static double derivative_lagrange_polynom(const double *lag_x,
                                               double *lag_f_x, double x);
-    double spline(double x);
-    double spline_error(double x);
+    static double end_slope(double *lag_x, double *lag_f_x, int k,
+                            double point);
+    double spline(double x) const;
+    double spline_error(double x) const;
+
+    double get_value(double x, interpolation_method method) const;
+    void evaluate(const double *xs, double *out, size_t count,
+                  interpolation_method method) const;
+
+    // View of the current fit; valid until the next modifying call.
+    interpolation_view view() const;
+
+    // Copies the current fit into a new immutable snapshot and swaps it in
+    // atomically. Readers on other threads keep evaluating whatever snapshot
+    // they already hold while the owner refits; none is published until the
+    // first call.
+    void publish();
+    std::shared_ptr<const interpolation_snapshot> snapshot() const;
+
+    friend class interpolation_snapshot;
+};
+
+// Immutable copy of a fit, shared between reader threads.
+class interpolation_snapshot
+{
+  private:
+    std::vector<double> x;
+    std::vector<double> f_x;
+    eytzinger_index index;
+    segment_table bessel_coeffs;
+    segment_table spline_coeffs;
+    interpolation_view v;
+
+  public:
+    explicit interpolation_snapshot(const interpolation &f);
+    ~interpolation_snapshot() = default;
+    interpolation_snapshot(const interpolation_snapshot &) = delete;
+    interpolation_snapshot &operator=(const interpolation_snapshot &) = delete;
 
-    double get_value(double x, interpolation_method method);
+    const interpolation_view &view() const { return v; }
 };
 
 #endif // INTERPOLATION_H
@@ -0,0 +1,276 @@
+#include "interpolation_file.h"
+#include "segment_table.h"
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static_assert(sizeof(interpolation_file_header) == 64,
+              "the header must fill one 64-byte block");
+static_assert(sizeof(segment) == 64, "segment records must be 64 bytes");
+
+static const char file_magic[8] = {'2', 'D', 'I', 'N', 'T', 'E', 'R', 'P'};
+static const uint32_t bessel_block = 1;
+static const uint32_t spline_block = 2;
+
+static bool little_endian_host()
+{
+    return __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__;
+}
+
+static size_t align64(size_t bytes)
+{
+    return (bytes + 63) & ~static_cast<size_t>(63);
+}
+
+// Byte offsets of the blocks of an n-node file.
+struct file_layout {
+    size_t x;
+    size_t f_x;
+    size_t bessel;
+    size_t spline;
+    size_t end;
+
+    explicit file_layout(size_t n)
+    {
+        x = sizeof(interpolation_file_header);
+        f_x = x + align64(n * sizeof(double));
+        bessel = f_x + align64(n * sizeof(double));
+        spline = bessel + (n - 1) * sizeof(segment);
+        end = spline + (n - 1) * sizeof(segment);
+    }
+};
+
+static bool write_padded(FILE *out, const void *data, size_t bytes)
+{
+    static const char zeros[64] = {};
+    size_t pad = align64(bytes) - bytes;
+    return fwrite(data, 1, bytes, out) == bytes &&
+           fwrite(zeros, 1, pad, out) == pad;
+}
+
+static bool write_segments(FILE *out, const cubic_view &coeffs)
+{
+    segment chunk[256] = {};
+    size_t done = 0;
+    while (done < coeffs.count) {
+        size_t count = coeffs.count - done;
+        if (count > 256) {
+            count = 256;
+        }
+        for (size_t k = 0; k < count; k++) {
+            size_t j = (done + k) * coeffs.stride;
+            chunk[k].x_left = coeffs.x_left[j];
+            chunk[k].inv_h = coeffs.inv_h[j];
+            chunk[k].c[0] = coeffs.c0[j];
+            chunk[k].c[1] = coeffs.c1[j];
+            chunk[k].c[2] = coeffs.c2[j];
+            chunk[k].c[3] = coeffs.c3[j];
+        }
+        if (fwrite(chunk, sizeof(segment), count, out) != count) {
+            return false;
+        }
+        done += count;
+    }
+    return true;
+}
+
+static cubic_view mapped_segments(const char *base, size_t offset,
+                                  size_t count)
+{
+    const segment *s = reinterpret_cast<const segment *>(base + offset);
+    cubic_view v = {};
+    v.x_left = &s->x_left;
+    v.inv_h = &s->inv_h;
+    v.c0 = &s->c[0];
+    v.c1 = &s->c[1];
+    v.c2 = &s->c[2];
+    v.c3 = &s->c[3];
+    v.stride = sizeof(segment) / sizeof(double);
+    v.count = count;
+    return v;
+}
+
+static bool copy_padded(FILE *out, FILE *in, size_t bytes)
+{
+    static const char zeros[64] = {};
+    char buffer[1 << 16];
+    size_t pad = align64(bytes) - bytes;
+
+    rewind(in);
+    while (bytes > 0) {
+        size_t count = bytes < sizeof(buffer) ? bytes : sizeof(buffer);
+        if (fread(buffer, 1, count, in) != count ||
+            fwrite(buffer, 1, count, out) != count) {
+            return false;
+        }
+        bytes -= count;
+    }
+    return fwrite(zeros, 1, pad, out) == pad;
+}
+
+interpolation_file_header make_file_header(double a, double b, size_t n,
+                                           int func_id, bool uniform)
+{
+    interpolation_file_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, file_magic, sizeof(file_magic));
+    header.version = interpolation_file_version;
+    header.grid = uniform ? 0 : 1;
+    header.a = a;
+    header.b = b;
+    header.n = n;
+    header.func_id = func_id;
+    header.methods = bessel_block | spline_block;
+    return header;
+}
+
+int save_interpolation(const interpolation_view &view, const char *path)
+{
+    if (!little_endian_host()) {
+        return file_endian_error;
+    }
+
+    size_t n = view.n;
+    if (view.n < 2 || !view.x || !view.f_x ||
+        view.bessel_coeffs.count != n - 1 ||
+        view.spline_coeffs.count != n - 1) {
+        return file_format_error;
+    }
+
+    interpolation_file_header header =
+        make_file_header(view.a, view.b, n, view.func_id, view.uniform);
+
+    FILE *out = fopen(path, "wb");
+    if (!out) {
+        return file_open_error;
+    }
+
+    bool written = fwrite(&header, sizeof(header), 1, out) == 1 &&
+                   write_padded(out, view.x, n * sizeof(double)) &&
+                   write_padded(out, view.f_x, n * sizeof(double)) &&
+                   write_segments(out, view.bessel_coeffs) &&
+                   write_segments(out, view.spline_coeffs);
+    if (fclose(out) != 0 || !written) {
+        return file_io_error;
+    }
+
+    return file_ok;
+}
+
+int save_interpolation(const interpolation_file_header &header, FILE *x,
+                       FILE *f_x, FILE *bessel, FILE *spline,
+                       const char *path)
+{
+    if (!little_endian_host()) {
+        return file_endian_error;
+    }
+    if (header.n < 2) {
+        return file_format_error;
+    }
+
+    FILE *out = fopen(path, "wb");
+    if (!out) {
+        return file_open_error;
+    }
+
+    size_t n = header.n;
+    bool written =
+        fwrite(&header, sizeof(header), 1, out) == 1 &&
+        copy_padded(out, x, n * sizeof(double)) &&
+        copy_padded(out, f_x, n * sizeof(double)) &&
+        copy_padded(out, bessel, (n - 1) * sizeof(segment)) &&
+        copy_padded(out, spline, (n - 1) * sizeof(segment));
+    if (fclose(out) != 0 || !written) {
+        return file_io_error;
+    }
+
+    return file_ok;
+}
+
+mapped_interpolation::~mapped_interpolation()
+{
+    close();
+}
+
+int mapped_interpolation::open(const char *path)
+{
+    close();
+    if (!little_endian_host()) {
+        return file_endian_error;
+    }
+
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+        return file_open_error;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        return file_io_error;
+    }
+    size_t size = static_cast<size_t>(st.st_size);
+    if (size < sizeof(interpolation_file_header)) {
+        ::close(fd);
+        return file_format_error;
+    }
+    void *mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        return file_io_error;
+    }
+
+    const char *base = static_cast<const char *>(mapped);
+    interpolation_file_header header;
+    memcpy(&header, base, sizeof(header));
+
+    int status = file_ok;
+    if (memcmp(header.magic, file_magic, sizeof(file_magic)) != 0) {
+        status = file_format_error;
+    } else if (header.version != interpolation_file_version) {
+        status = file_version_error;
+    } else if (header.n < 2 || header.n > 0x7fffffff || header.grid > 1 ||
+               header.methods != (bessel_block | spline_block) ||
+               file_layout(header.n).end > size) {
+        status = file_format_error;
+    }
+    if (status != file_ok) {
+        munmap(mapped, size);
+        return status;
+    }
+
+    file_layout layout(header.n);
+    data = mapped;
+    length = size;
+
+    v = interpolation_view();
+    v.a = header.a;
+    v.b = header.b;
+    v.n = static_cast<int>(header.n);
+    v.func_id = header.func_id;
+    v.uniform = header.grid == 0;
+    v.step = (v.b - v.a) / (v.n - 1);
+    v.x = reinterpret_cast<const double *>(base + layout.x);
+    v.f_x = reinterpret_cast<const double *>(base + layout.f_x);
+    v.bessel_coeffs = mapped_segments(base, layout.bessel, header.n - 1);
+    v.spline_coeffs = mapped_segments(base, layout.spline, header.n - 1);
+    if (!v.uniform) {
+        index.build(v.x, v.n);
+        v.index = &index;
+    }
+
+    return file_ok;
+}
+
+void mapped_interpolation::close()
+{
+    if (data) {
+        munmap(data, length);
+    }
+    data = nullptr;
+    length = 0;
+    index.clear();
+    v = interpolation_view();
+}
@@ -0,0 +1,85 @@
+#ifndef INTERPOLATION_FILE_H
+#define INTERPOLATION_FILE_H
+
+#include "interpolation_view.h"
+#include "test_functions.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+// Binary file of a fit, version 1. All numbers are little endian and every
+// block starts at a multiple of 64 bytes from the start of the file:
+//   header          64 bytes
+//   x               n doubles
+//   f_x             n doubles
+//   bessel segments n - 1 segment records of 64 bytes
+//   spline segments n - 1 segment records of 64 bytes
+// The segment records have the layout of struct segment, so a mapped file
+// is evaluated in place.
+struct interpolation_file_header {
+    char magic[8];
+    uint32_t version;
+    // 0: uniform grid with step (b - a) / (n - 1), 1: arbitrary sorted x.
+    uint32_t grid;
+    double a;
+    double b;
+    uint64_t n;
+    int32_t func_id;
+    // Bit 0: Bessel segments present, bit 1: spline segments present.
+    uint32_t methods;
+    uint64_t reserved[2];
+};
+
+enum interpolation_file_status {
+    file_ok = 0,
+    file_open_error = -1,
+    file_io_error = -2,
+    file_format_error = -3,
+    file_version_error = -4,
+    file_endian_error = -5,
+    file_data_error = -6,
+};
+
+const uint32_t interpolation_file_version = 1;
+
+// Header of an n-node file holding both coefficient blocks.
+interpolation_file_header make_file_header(double a, double b, size_t n,
+                                           int func_id, bool uniform);
+
+// Writes the fit behind view to path. Returns file_ok or a negative
+// interpolation_file_status.
+int save_interpolation(const interpolation_view &view, const char *path);
+// Writes a file whose blocks were serialized beforehand: n doubles each in
+// x and f_x, n - 1 segment records each in bessel and spline. The streams
+// are read from their start.
+int save_interpolation(const interpolation_file_header &header, FILE *x,
+                       FILE *f_x, FILE *bessel, FILE *spline,
+                       const char *path);
+
+// Read-only fit mapped from a file written by save_interpolation. The view
+// points into the mapping and stays valid until close() or destruction.
+class mapped_interpolation
+{
+  private:
+    void *data = nullptr;
+    size_t length = 0;
+    // Built from the mapped nodes when the grid is not uniform.
+    eytzinger_index index;
+    interpolation_view v;
+
+  public:
+    mapped_interpolation() = default;
+    ~mapped_interpolation();
+    mapped_interpolation(const mapped_interpolation &) = delete;
+    mapped_interpolation &
+    operator=(const mapped_interpolation &) = delete;
+
+    // Returns file_ok or a negative interpolation_file_status.
+    int open(const char *path);
+    void close();
+
+    bool is_open() const { return data != nullptr; }
+    const interpolation_view &view() const { return v; }
+};
+
+#endif // INTERPOLATION_FILE_H
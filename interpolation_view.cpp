@@ -0,0 +1,228 @@
+#include "interpolation_view.h"
+#include "stats.h"
+#include "test_functions.h"
+#include <algorithm>
+#include <cmath>
+
+#ifdef INTERPOLATION_STATS
+static stat_counter eval_counter(interpolation_method method)
+{
+    return static_cast<stat_counter>(
+        static_cast<int>(stat_counter::eval_origin) + static_cast<int>(method));
+}
+#endif
+
+// Index of the segment [x[i], x[i + 1]] holding new_x, clamped to
+// [0, n - 2] so that points outside [a, b] extrapolate the end segments.
+int interpolation_view::find_segment(double new_x) const
+{
+    if (!uniform) {
+        if (index) {
+            STATS_COUNT(stat_counter::search_index, 1);
+            return index->find(new_x);
+        }
+        return binary_search(new_x);
+    }
+
+    double t = floor((new_x - a) / step);
+    if (!(t > 0.)) {
+        return 0;
+    }
+    if (t > n - 2) {
+        return n - 2;
+    }
+    return static_cast<int>(t);
+}
+
+int interpolation_view::binary_search(double curr_x) const
+{
+    int left = 0;
+    int right = n - 1;
+    STATS_COUNT(stat_counter::search_binary, 1);
+    while (right - left > 1) {
+        STATS_COUNT(stat_counter::search_binary_steps, 1);
+        int medium = (left + right) / 2;
+        if (curr_x >= x[medium]) {
+            left = medium;
+        } else {
+            right = medium;
+        }
+    }
+    return left;
+}
+
+double interpolation_view::bessel(double new_x) const
+{
+    return segment_value(find_segment(new_x), new_x,
+                         interpolation_method::bessel);
+}
+
+double interpolation_view::spline(double new_x) const
+{
+    return segment_value(find_segment(new_x), new_x,
+                         interpolation_method::spline);
+}
+
+double interpolation_view::bessel_error(double new_x) const
+{
+    return func(func_id, new_x) - bessel(new_x);
+}
+
+double interpolation_view::spline_error(double new_x) const
+{
+    return func(func_id, new_x) - spline(new_x);
+}
+
+double interpolation_view::get_value(double new_x,
+                                     interpolation_method method) const
+{
+    STATS_COUNT(eval_counter(method), 1);
+    if (method == interpolation_method::origin) {
+        return func(func_id, new_x);
+    }
+    return segment_value(find_segment(new_x), new_x, method);
+}
+
+double interpolation_view::segment_value(int i, double new_x,
+                                         interpolation_method method) const
+{
+    switch (method) {
+    case interpolation_method::origin:
+        return func(func_id, new_x);
+    case interpolation_method::bessel:
+        if (n < 2) {
+            return 0.;
+        }
+        return cubic_value(bessel_coeffs, i, new_x);
+    case interpolation_method::spline:
+        if (n < 2 || fabs(x[1] - x[0]) <= eps) {
+            return 0.;
+        }
+        return cubic_value(spline_coeffs, i, new_x);
+    case interpolation_method::error_bessel:
+        return func(func_id, new_x) -
+               segment_value(i, new_x, interpolation_method::bessel);
+    case interpolation_method::error_spline:
+        return func(func_id, new_x) -
+               segment_value(i, new_x, interpolation_method::spline);
+    }
+    return 0;
+}
+
+// Evaluates the method at count abscissae. A cursor carries the segment from
+// one point to the next, so for sorted xs the whole sweep costs O(n + count)
+// and only longer jumps pay for a fresh search. Segment indices are collected
+// block by block and handed to the vectorized cubic kernel; the exact values
+// come from the function's batch loop, one indirect call per block.
+void interpolation_view::evaluate(const double *xs, double *out, size_t count,
+                                  interpolation_method method) const
+{
+    if (count == 0) {
+        return;
+    }
+
+    const test_function *fn = find_function(func_id);
+    if (method == interpolation_method::origin && fn) {
+        STATS_COUNT(eval_counter(method), count);
+        fn->values(xs, out, count);
+        return;
+    }
+    if (method == interpolation_method::origin || n < 2) {
+        for (size_t k = 0; k < count; k++) {
+            out[k] = get_value(xs[k], method);
+        }
+        return;
+    }
+    STATS_COUNT(eval_counter(method), count);
+
+    bool use_bessel = method == interpolation_method::bessel ||
+                      method == interpolation_method::error_bessel;
+    bool with_error = method == interpolation_method::error_bessel ||
+                      method == interpolation_method::error_spline;
+    bool degenerate = !use_bessel && fabs(x[1] - x[0]) <= eps;
+    const cubic_view &coeffs = use_bessel ? bessel_coeffs : spline_coeffs;
+
+    const size_t block_size = 256;
+    int seg[block_size];
+    double exact[block_size];
+    interpolation_cursor cursor(*this);
+
+    for (size_t start = 0; start < count; start += block_size) {
+        size_t len = count - start < block_size ? count - start : block_size;
+        const double *block_x = xs + start;
+        double *block_out = out + start;
+
+        for (size_t k = 0; k < len; k++) {
+            seg[k] = cursor.find_segment(block_x[k]);
+        }
+
+        if (degenerate) {
+            for (size_t k = 0; k < len; k++) {
+                block_out[k] = 0.;
+            }
+        } else {
+            cubic_eval(coeffs, seg, block_x, block_out, len);
+        }
+
+        if (with_error) {
+            if (fn) {
+                fn->values(block_x, exact, len);
+            } else {
+                std::fill(exact, exact + len, 0.);
+            }
+            for (size_t k = 0; k < len; k++) {
+                block_out[k] = exact[k] - block_out[k];
+            }
+        }
+    }
+}
+
+// Segment i is [x[i], x[i + 1]), open towards the outside at both ends, as
+// in binary_search.
+int interpolation_cursor::find_segment(double new_x)
+{
+    const double *x = v.x;
+    int last = v.n - 2;
+    int i = hint;
+    if (last <= 0) {
+        return 0;
+    }
+
+    if ((i == 0 || new_x >= x[i]) && (i == last || new_x < x[i + 1])) {
+        return i;
+    }
+    if (i < last && new_x >= x[i + 1] && (i + 1 == last || new_x < x[i + 2])) {
+        STATS_COUNT(stat_counter::search_walk_steps, 1);
+        hint = i + 1;
+        return hint;
+    }
+    if (i > 0 && new_x < x[i] && (i == 1 || new_x >= x[i - 1])) {
+        STATS_COUNT(stat_counter::search_walk_steps, 1);
+        hint = i - 1;
+        return hint;
+    }
+
+    STATS_COUNT(stat_counter::search_walk_jumps, 1);
+    hint = v.find_segment(new_x);
+    return hint;
+}
+
+double interpolation_cursor::bessel(double new_x)
+{
+    return get_value(new_x, interpolation_method::bessel);
+}
+
+double interpolation_cursor::spline(double new_x)
+{
+    return get_value(new_x, interpolation_method::spline);
+}
+
+double interpolation_cursor::get_value(double new_x,
+                                       interpolation_method method)
+{
+    STATS_COUNT(eval_counter(method), 1);
+    if (method == interpolation_method::origin) {
+        return func(v.func_id, new_x);
+    }
+    return v.segment_value(find_segment(new_x), new_x, method);
+}
@@ -0,0 +1,79 @@
+#ifndef INTERPOLATION_VIEW_H
+#define INTERPOLATION_VIEW_H
+
+#include "cubic_kernel.h"
+#include "eytzinger_index.h"
+#include <cstddef>
+
+enum class interpolation_method {
+    origin,
+    bessel,
+    spline,
+    error_bessel,
+    error_spline,
+};
+
+double func(int func_id, double x);
+
+// Read-only evaluator over node and coefficient arrays owned by someone else
+// (an interpolation, a published snapshot or a mapped file). All methods are
+// const and keep no state between calls, so one view may be shared by any
+// number of threads as long as the arrays outlive it and are not modified.
+class interpolation_view
+{
+  public:
+    static constexpr double eps = 1e-14;
+
+    double a = 0.;
+    double b = 0.;
+    int n = 0;
+    int func_id = 0;
+    double step = 0.;
+    bool uniform = true;
+    const double *x = nullptr;
+    // Segment index of x for a nonuniform grid; without one lookups fall
+    // back to binary_search.
+    const eytzinger_index *index = nullptr;
+    const double *f_x = nullptr;
+    cubic_view bessel_coeffs = {};
+    cubic_view spline_coeffs = {};
+
+    int find_segment(double new_x) const;
+    int binary_search(double new_x) const;
+
+    double bessel(double new_x) const;
+    double bessel_error(double new_x) const;
+    double spline(double new_x) const;
+    double spline_error(double new_x) const;
+
+    double get_value(double new_x, interpolation_method method) const;
+    // Value of the method at new_x taken from segment i, which must be
+    // find_segment(new_x) or a neighbour of it.
+    double segment_value(int i, double new_x,
+                         interpolation_method method) const;
+    void evaluate(const double *xs, double *out, size_t count,
+                  interpolation_method method) const;
+};
+
+// Point-by-point evaluation that remembers the last segment. Each lookup
+// tries that segment and its two neighbours before a full find_segment, so
+// slowly moving queries cost O(1) each in either direction without any
+// sorting. The cursor holds its own copy of the view, so each thread keeps
+// its own; it is valid as long as the view is.
+class interpolation_cursor
+{
+  private:
+    interpolation_view v;
+    int hint = 0;
+
+  public:
+    explicit interpolation_cursor(const interpolation_view &view) : v(view) {}
+    ~interpolation_cursor() = default;
+
+    int find_segment(double new_x);
+    double bessel(double new_x);
+    double spline(double new_x);
+    double get_value(double new_x, interpolation_method method);
+};
+
+#endif // INTERPOLATION_VIEW_H
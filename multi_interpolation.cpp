@@ -0,0 +1,187 @@
+#include "multi_interpolation.h"
+#include <cmath>
+
+multi_interpolation::multi_interpolation(double new_a, double new_b,
+                                         int new_n, int new_channels)
+{
+    a = new_a;
+    b = new_b;
+    n = new_n;
+    channels = new_channels;
+    step = (b - a) / (n - 1);
+
+    x.resize(n);
+    for (int i = 0; i < n; i++) {
+        x[i] = a + i * step;
+    }
+
+    size_t width = static_cast<size_t>(channels);
+    f_x.assign(n * width, 0.);
+    d.resize(n * width);
+    bessel_coeffs.assign(4 * (n - 1) * width, 0.);
+    spline_coeffs.assign(4 * (n - 1) * width, 0.);
+
+    std::vector<double> diag(n, 4. * step);
+    std::vector<double> up_diag(n, step);
+    std::vector<double> low_diag(n, step);
+    diag[0] = 1.;
+    up_diag[0] = 0.;
+    diag[n - 1] = 1.;
+    low_diag[n - 2] = 0.;
+    spline_lu.factor(low_diag, diag, up_diag, n,
+                     n >= interpolation::parallel_solve_min_n ? 0 : 1);
+}
+
+int multi_interpolation::find_segment(double new_x) const
+{
+    double t = floor((new_x - a) / step);
+    if (!(t > 0.)) {
+        return 0;
+    }
+    if (t > n - 2) {
+        return n - 2;
+    }
+    return static_cast<int>(t);
+}
+
+void multi_interpolation::set_segment(std::vector<double> &coeffs, int i,
+                                      const double *slopes)
+{
+    const double *f0 = f_x.data() + static_cast<size_t>(i) * channels;
+    const double *f1 = f0 + channels;
+    const double *d0 = slopes + static_cast<size_t>(i) * channels;
+    const double *d1 = d0 + channels;
+    double *c = coeffs.data() + static_cast<size_t>(4 * i) * channels;
+
+    for (int j = 0; j < channels; j++) {
+        double delta = f1[j] - f0[j];
+        double s0 = d0[j] * step;
+        double s1 = d1[j] * step;
+        c[j] = f0[j];
+        c[channels + j] = s0;
+        c[2 * channels + j] = 3. * delta - 2. * s0 - s1;
+        c[3 * channels + j] = s0 + s1 - 2. * delta;
+    }
+}
+
+void multi_interpolation::update_bessel_coeffs()
+{
+    // On a uniform grid the Bessel slope is the central difference.
+    for (int i = 1; i < n - 1; i++) {
+        const double *f = f_x.data() + static_cast<size_t>(i) * channels;
+        double *s = d.data() + static_cast<size_t>(i) * channels;
+        for (int j = 0; j < channels; j++) {
+            s[j] = (f[channels + j] - f[j - channels]) / (2. * step);
+        }
+    }
+
+    // The second derivative at the ends is estimated by the second divided
+    // difference of the three outermost samples.
+    double *s0 = d.data();
+    double *s1 = s0 + channels;
+    double *s_last = d.data() + static_cast<size_t>(n - 1) * channels;
+    double *s_prev = s_last - channels;
+    const double *f0 = f_x.data();
+    const double *f_last = f_x.data() + static_cast<size_t>(n - 1) * channels;
+    for (int j = 0; j < channels; j++) {
+        double f1 = f0[channels + j];
+        double f2 = f0[2 * channels + j];
+        double tmp = (f1 - f0[j]) / step;
+        double der2 = (f0[j] - 2. * f1 + f2) / step / step;
+        s0[j] = 0.5 * (3 * tmp - s1[j] - 0.5 * der2 * step);
+
+        f1 = f_last[j - channels];
+        f2 = f_last[j - 2 * channels];
+        tmp = (f_last[j] - f1) / step;
+        der2 = (f_last[j] - 2. * f1 + f2) / step / step;
+        s_last[j] = 0.5 * (3 * tmp - s_prev[j] + 0.5 * der2 * step);
+    }
+
+    for (int i = 0; i < n - 1; i++) {
+        set_segment(bessel_coeffs, i, d.data());
+    }
+}
+
+void multi_interpolation::update_spline_coeffs()
+{
+    int k = n < 4 ? n : 4;
+    double lag_x[4];
+    double lag_f_x[4];
+    spline_d.resize(static_cast<size_t>(n) * channels);
+    double *last = spline_d.data() + static_cast<size_t>(n - 1) * channels;
+
+    for (int j = 0; j < channels; j++) {
+        for (int i = 0; i < k; i++) {
+            lag_x[i] = x[i];
+            lag_f_x[i] = f_x[static_cast<size_t>(i) * channels + j];
+        }
+        spline_d[j] = interpolation::end_slope(lag_x, lag_f_x, k, a);
+
+        for (int i = 0; i < k; i++) {
+            lag_x[i] = x[n - k + i];
+            lag_f_x[i] = f_x[static_cast<size_t>(n - k + i) * channels + j];
+        }
+        last[j] = interpolation::end_slope(lag_x, lag_f_x, k, b);
+    }
+
+    for (int i = 1; i < n - 1; i++) {
+        const double *f = f_x.data() + static_cast<size_t>(i) * channels;
+        double *s = spline_d.data() + static_cast<size_t>(i) * channels;
+        for (int j = 0; j < channels; j++) {
+            s[j] = 3. * (f[channels + j] - f[j - channels]);
+        }
+    }
+
+    spline_lu.solve_many(spline_d.data(), channels);
+
+    for (int i = 0; i < n - 1; i++) {
+        set_segment(spline_coeffs, i, spline_d.data());
+    }
+}
+
+void multi_interpolation::set_values(const double *values)
+{
+    f_x.assign(values, values + static_cast<size_t>(n) * channels);
+
+    update_bessel_coeffs();
+    update_spline_coeffs();
+}
+
+void multi_interpolation::set_channel(int c, const double *values)
+{
+    for (int i = 0; i < n; i++) {
+        f_x[static_cast<size_t>(i) * channels + c] = values[i];
+    }
+
+    update_bessel_coeffs();
+    update_spline_coeffs();
+}
+
+void multi_interpolation::get_value(double new_x, interpolation_method method,
+                                    double *out) const
+{
+    evaluate(&new_x, out, 1, method);
+}
+
+void multi_interpolation::evaluate(const double *xs, double *out,
+                                   size_t count,
+                                   interpolation_method method) const
+{
+    const std::vector<double> &coeffs =
+        method == interpolation_method::spline ? spline_coeffs
+                                               : bessel_coeffs;
+
+    for (size_t k = 0; k < count; k++) {
+        int i = find_segment(xs[k]);
+        double t = (xs[k] - x[i]) / step;
+        const double *c0 =
+            coeffs.data() + static_cast<size_t>(4 * i) * channels;
+        const double *c1 = c0 + channels;
+        const double *c2 = c1 + channels;
+        const double *c3 = c2 + channels;
+        double *row = out + k * channels;
+        for (int j = 0; j < channels; j++) {
+            row[j] = c0[j] + t * (c1[j] + t * (c2[j] + t * c3[j]));
+        }
+    }
+}
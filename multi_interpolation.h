@@ -0,0 +1,59 @@
+#ifndef MULTI_INTERPOLATION_H
+#define MULTI_INTERPOLATION_H
+
+#include "interpolation.h"
+#include "tridiagonal.h"
+#include <cstddef>
+#include <vector>
+
+// Bessel and spline fits of several signals sampled on one uniform grid of
+// n >= 3 nodes on [a, b]. Values are interleaved by node, values[i * channels
+// + c], and the coefficients of segment i are stored as
+// coeffs[(4 * i + k) * channels + c] in the normalized variable
+// t = (x - x[i]) / step, so one segment lookup serves every channel. The end
+// conditions are estimated from the samples themselves.
+class multi_interpolation
+{
+  private:
+    double a = 0.;
+    double b = 0.;
+    int n = 0;
+    int channels = 0;
+    double step = 0.;
+
+    std::vector<double> x;
+    std::vector<double> f_x;
+    std::vector<double> d;
+    std::vector<double> bessel_coeffs;
+    std::vector<double> spline_coeffs;
+    std::vector<double> spline_d;
+    tridiagonal_lu spline_lu;
+
+    int find_segment(double new_x) const;
+    void set_segment(std::vector<double> &coeffs, int i,
+                     const double *slopes);
+    void update_bessel_coeffs();
+    void update_spline_coeffs();
+
+  public:
+    multi_interpolation(double a, double b, int n, int channels);
+    ~multi_interpolation() = default;
+
+    int size() const { return n; }
+    int channel_count() const { return channels; }
+    double node(int i) const { return x[i]; }
+
+    // Replaces all samples (n * channels values, interleaved by node) or
+    // one channel (n values) and refits.
+    void set_values(const double *values);
+    void set_channel(int c, const double *values);
+
+    // Writes channels values of the bessel or spline fit at new_x.
+    void get_value(double new_x, interpolation_method method,
+                   double *out) const;
+    // out[k * channels + c] is channel c at xs[k].
+    void evaluate(const double *xs, double *out, size_t count,
+                  interpolation_method method) const;
+};
+
+#endif // MULTI_INTERPOLATION_H
@@ -0,0 +1,41 @@
+#include "parallel_evaluate.h"
+#include <algorithm>
+
+// Start of chunk k. The nominal start k * grain is pulled back to the first
+// point at or after x[i] in the window [k * grain - grain / 2, k * grain],
+// where i is the segment of the nominal start. The windows of neighbouring
+// chunks do not overlap, so the starts stay increasing and every worker
+// computes its own bounds.
+static size_t chunk_start(const interpolation_view &view, const double *xs,
+                          size_t count, size_t grain, size_t k)
+{
+    size_t nominal = k * grain;
+    if (nominal >= count) {
+        return count;
+    }
+    if (k == 0 || view.n < 2) {
+        return nominal;
+    }
+
+    int i = view.find_segment(xs[nominal]);
+    if (i == 0) {
+        return nominal;
+    }
+    const double *lo = xs + nominal - grain / 2;
+    const double *hi = xs + nominal;
+    return std::lower_bound(lo, hi, view.x[i]) - xs;
+}
+
+void parallel_evaluate(thread_pool &pool, const interpolation_view &view,
+                       const double *xs, double *out, size_t count,
+                       interpolation_method method, size_t grain)
+{
+    grain = grain < 2 ? 2 : grain;
+    size_t chunks = (count + grain - 1) / grain;
+
+    pool.run(chunks, [&](size_t k) {
+        size_t first = chunk_start(view, xs, count, grain, k);
+        size_t last = chunk_start(view, xs, count, grain, k + 1);
+        view.evaluate(xs + first, out + first, last - first, method);
+    });
+}
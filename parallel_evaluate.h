@@ -0,0 +1,21 @@
+#ifndef PARALLEL_EVALUATE_H
+#define PARALLEL_EVALUATE_H
+
+#include "interpolation_view.h"
+#include "thread_pool.h"
+#include <cstddef>
+
+const size_t default_evaluate_grain = 1 << 14;
+
+// interpolation_view::evaluate spread over the pool in chunks of about
+// grain points. For sorted xs each chunk boundary is moved back, by at most
+// grain / 2 points, to the first point of the segment it falls in, so that
+// no segment is shared by two chunks and every chunk's cursor walks its own
+// stretch of the coefficient table. Any order of xs gives the same values;
+// unsorted input only loses the alignment.
+void parallel_evaluate(thread_pool &pool, const interpolation_view &view,
+                       const double *xs, double *out, size_t count,
+                       interpolation_method method,
+                       size_t grain = default_evaluate_grain);
+
+#endif // PARALLEL_EVALUATE_H
@@ -0,0 +1,131 @@
+#include "segment_table.h"
+
+void segment_table::set_layout(segment_layout new_layout)
+{
+    if (new_layout == layout) {
+        return;
+    }
+
+    if (new_layout == segment_layout::soa) {
+        for (int j = 0; j < 6; j++) {
+            columns[j].resize(count);
+        }
+        for (int i = 0; i < count; i++) {
+            const segment &s = records[i];
+            columns[0][i] = s.x_left;
+            columns[1][i] = s.inv_h;
+            for (int j = 0; j < 4; j++) {
+                columns[j + 2][i] = s.c[j];
+            }
+        }
+        records = std::vector<segment>();
+    } else {
+        records.resize(count);
+        for (int i = 0; i < count; i++) {
+            records[i] = get(i);
+        }
+        for (int j = 0; j < 6; j++) {
+            columns[j] = std::vector<double>();
+        }
+    }
+
+    layout = new_layout;
+}
+
+void segment_table::resize(int new_count)
+{
+    count = new_count < 0 ? 0 : new_count;
+    if (layout == segment_layout::aos) {
+        records.resize(count);
+    } else {
+        for (int j = 0; j < 6; j++) {
+            columns[j].resize(count);
+        }
+    }
+}
+
+segment make_segment(double x_left, double h, double c0, double c1, double c2,
+                     double c3)
+{
+    segment s = {};
+    s.x_left = x_left;
+    s.inv_h = 1. / h;
+    s.c[0] = c0;
+    s.c[1] = c1 * h;
+    s.c[2] = c2 * h * h;
+    s.c[3] = c3 * h * h * h;
+    return s;
+}
+
+void segment_table::set(int i, double x_left, double h, double c0, double c1,
+                        double c2, double c3)
+{
+    segment s = make_segment(x_left, h, c0, c1, c2, c3);
+
+    if (layout == segment_layout::aos) {
+        records[i] = s;
+    } else {
+        columns[0][i] = s.x_left;
+        columns[1][i] = s.inv_h;
+        for (int j = 0; j < 4; j++) {
+            columns[j + 2][i] = s.c[j];
+        }
+    }
+}
+
+segment segment_table::get(int i) const
+{
+    if (layout == segment_layout::aos) {
+        return records[i];
+    }
+
+    segment s = {};
+    s.x_left = columns[0][i];
+    s.inv_h = columns[1][i];
+    for (int j = 0; j < 4; j++) {
+        s.c[j] = columns[j + 2][i];
+    }
+    return s;
+}
+
+double segment_table::value(int i, double x) const
+{
+    if (layout == segment_layout::aos) {
+        const segment &s = records[i];
+        double t = (x - s.x_left) * s.inv_h;
+        return s.c[0] + t * (s.c[1] + t * (s.c[2] + t * s.c[3]));
+    }
+
+    double t = (x - columns[0][i]) * columns[1][i];
+    return columns[2][i] +
+           t * (columns[3][i] + t * (columns[4][i] + t * columns[5][i]));
+}
+
+cubic_view segment_table::view() const
+{
+    cubic_view v = {};
+    if (count == 0) {
+        return v;
+    }
+
+    if (layout == segment_layout::aos) {
+        const segment *s = records.data();
+        v.x_left = &s->x_left;
+        v.inv_h = &s->inv_h;
+        v.c0 = &s->c[0];
+        v.c1 = &s->c[1];
+        v.c2 = &s->c[2];
+        v.c3 = &s->c[3];
+        v.stride = sizeof(segment) / sizeof(double);
+    } else {
+        v.x_left = columns[0].data();
+        v.inv_h = columns[1].data();
+        v.c0 = columns[2].data();
+        v.c1 = columns[3].data();
+        v.c2 = columns[4].data();
+        v.c3 = columns[5].data();
+        v.stride = 1;
+    }
+    v.count = count;
+    return v;
+}
@@ -0,0 +1,57 @@
+#ifndef SEGMENT_TABLE_H
+#define SEGMENT_TABLE_H
+
+#include "cubic_kernel.h"
+#include <cstddef>
+#include <vector>
+
+// One cubic piece on [x_left, x_left + h] in the normalized variable
+// t = (x - x_left) * inv_h, padded to a single cache line.
+struct alignas(64) segment {
+    double x_left;
+    double inv_h;
+    double c[4];
+    // Zero, so that saved records hold no stray bytes.
+    double unused[2];
+};
+
+// Record of c0 + c1 * s + c2 * s^2 + c3 * s^3, s = x - x_left, on a piece
+// of width h.
+segment make_segment(double x_left, double h, double c0, double c1, double c2,
+                     double c3);
+
+enum class segment_layout {
+    aos,
+    soa,
+};
+
+// Coefficients of a piecewise cubic, stored either as an array of segment
+// records (one cache line per lookup) or as six separate arrays (contiguous
+// lanes for vectorized batches).
+class segment_table
+{
+  private:
+    segment_layout layout = segment_layout::aos;
+    int count = 0;
+    std::vector<segment> records;
+    // x_left, inv_h, c0, c1, c2, c3
+    std::vector<double> columns[6];
+
+  public:
+    segment_table() = default;
+    ~segment_table() = default;
+
+    int size() const { return count; }
+    segment_layout get_layout() const { return layout; }
+    void set_layout(segment_layout new_layout);
+    void resize(int new_count);
+
+    // Stores c0 + c1 * s + c2 * s^2 + c3 * s^3, s = x - x_left.
+    void set(int i, double x_left, double h, double c0, double c1, double c2,
+             double c3);
+    segment get(int i) const;
+    double value(int i, double x) const;
+    cubic_view view() const;
+};
+
+#endif // SEGMENT_TABLE_H
@@ -0,0 +1,156 @@
+#include "stats.h"
+#include <cstring>
+
+static const char *counter_names[] = {
+    "refit_construct",
+    "refit_change_n",
+    "refit_change_func",
+    "refit_disturb",
+    "refit_scale",
+    "node_update",
+    "eval_origin",
+    "eval_bessel",
+    "eval_spline",
+    "eval_error_bessel",
+    "eval_error_spline",
+    "search_binary",
+    "search_binary_steps",
+    "search_index",
+    "search_walk_steps",
+    "search_walk_jumps",
+};
+static_assert(sizeof(counter_names) / sizeof(counter_names[0]) ==
+                  static_cast<size_t>(stat_counter::count),
+              "every counter needs a name");
+
+static const char *timer_names[] = {
+    "solve",
+    "bessel_update",
+    "spline_update",
+    "paint",
+};
+static_assert(sizeof(timer_names) / sizeof(timer_names[0]) ==
+                  static_cast<size_t>(stat_timer::count),
+              "every timer needs a name");
+
+const char *stat_name(stat_counter counter)
+{
+    return counter_names[static_cast<int>(counter)];
+}
+
+const char *stat_name(stat_timer timer)
+{
+    return timer_names[static_cast<int>(timer)];
+}
+
+#ifdef INTERPOLATION_STATS
+
+#include <atomic>
+#include <chrono>
+
+static const int counter_count = static_cast<int>(stat_counter::count);
+static const int timer_count = static_cast<int>(stat_timer::count);
+
+static std::atomic<uint64_t> counters[counter_count];
+static std::atomic<uint64_t> timer_ns[timer_count];
+static std::atomic<uint64_t> timer_calls[timer_count];
+
+static uint64_t now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+bool stats_enabled()
+{
+    return true;
+}
+
+void stats_add(stat_counter counter, uint64_t count)
+{
+    counters[static_cast<int>(counter)].fetch_add(count,
+                                                  std::memory_order_relaxed);
+}
+
+void stats_add_time(stat_timer timer, uint64_t ns)
+{
+    timer_ns[static_cast<int>(timer)].fetch_add(ns, std::memory_order_relaxed);
+    timer_calls[static_cast<int>(timer)].fetch_add(1,
+                                                   std::memory_order_relaxed);
+}
+
+scoped_stat_timer::scoped_stat_timer(stat_timer timer)
+    : timer(timer), start(now_ns())
+{
+}
+
+scoped_stat_timer::~scoped_stat_timer()
+{
+    stats_add_time(timer, now_ns() - start);
+}
+
+stats_snapshot read_stats()
+{
+    stats_snapshot s;
+    for (int i = 0; i < counter_count; i++) {
+        s.counters[i] = counters[i].load(std::memory_order_relaxed);
+    }
+    for (int i = 0; i < timer_count; i++) {
+        s.timer_ns[i] = timer_ns[i].load(std::memory_order_relaxed);
+        s.timer_calls[i] = timer_calls[i].load(std::memory_order_relaxed);
+    }
+    return s;
+}
+
+void reset_stats()
+{
+    for (std::atomic<uint64_t> &c : counters) {
+        c.store(0, std::memory_order_relaxed);
+    }
+    for (int i = 0; i < timer_count; i++) {
+        timer_ns[i].store(0, std::memory_order_relaxed);
+        timer_calls[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+#else
+
+bool stats_enabled()
+{
+    return false;
+}
+
+stats_snapshot read_stats()
+{
+    stats_snapshot s;
+    memset(&s, 0, sizeof(s));
+    return s;
+}
+
+void reset_stats()
+{
+}
+
+#endif
+
+std::string stats_report()
+{
+    stats_snapshot s = read_stats();
+    std::string report;
+
+    for (int i = 0; i < static_cast<int>(stat_counter::count); i++) {
+        if (s.counters[i] != 0) {
+            report = report + counter_names[i] + " = " +
+                     std::to_string(s.counters[i]) + "\n";
+        }
+    }
+    for (int i = 0; i < static_cast<int>(stat_timer::count); i++) {
+        if (s.timer_calls[i] != 0) {
+            report = report + timer_names[i] + " = " +
+                     std::to_string(s.timer_ns[i] / 1000000.) + " ms / " +
+                     std::to_string(s.timer_calls[i]) + "\n";
+        }
+    }
+    return report;
+}
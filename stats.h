@@ -0,0 +1,90 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <cstdint>
+#include <string>
+
+// Hot-path counters and timers. They are compiled in only with
+// INTERPOLATION_STATS defined (qmake CONFIG+=stats, cmake
+// -DINTERPOLATION_STATS=ON); otherwise STATS_COUNT and STATS_TIME expand to
+// nothing and read_stats() returns zeros. Counters are relaxed atomics, so
+// worker and reader threads may update them concurrently.
+
+enum class stat_counter {
+    // Refits by trigger.
+    refit_construct,
+    refit_change_n,
+    refit_change_func,
+    refit_disturb,
+    refit_scale,
+    node_update,
+    // Points evaluated by method, in interpolation_method order.
+    eval_origin,
+    eval_bessel,
+    eval_spline,
+    eval_error_bessel,
+    eval_error_spline,
+    // binary_search calls and halving steps, Eytzinger index lookups;
+    // neighbour steps and full searches of interpolation_cursor.
+    search_binary,
+    search_binary_steps,
+    search_index,
+    search_walk_steps,
+    search_walk_jumps,
+    count,
+};
+
+enum class stat_timer {
+    solve,
+    bessel_update,
+    spline_update,
+    paint,
+    count,
+};
+
+struct stats_snapshot {
+    uint64_t counters[static_cast<int>(stat_counter::count)];
+    uint64_t timer_ns[static_cast<int>(stat_timer::count)];
+    uint64_t timer_calls[static_cast<int>(stat_timer::count)];
+};
+
+bool stats_enabled();
+stats_snapshot read_stats();
+void reset_stats();
+const char *stat_name(stat_counter counter);
+const char *stat_name(stat_timer timer);
+// One "name = value" line per nonzero counter and timer.
+std::string stats_report();
+
+#ifdef INTERPOLATION_STATS
+
+void stats_add(stat_counter counter, uint64_t count);
+void stats_add_time(stat_timer timer, uint64_t ns);
+
+class scoped_stat_timer
+{
+  private:
+    stat_timer timer;
+    uint64_t start;
+
+  public:
+    explicit scoped_stat_timer(stat_timer timer);
+    ~scoped_stat_timer();
+    scoped_stat_timer(const scoped_stat_timer &) = delete;
+    scoped_stat_timer &operator=(const scoped_stat_timer &) = delete;
+};
+
+#define STATS_CONCAT_(a, b) a##b
+#define STATS_CONCAT(a, b) STATS_CONCAT_(a, b)
+#define STATS_COUNT(counter, n) stats_add((counter), (n))
+#define STATS_TIME(timer)                                                     \
+    scoped_stat_timer STATS_CONCAT(stats_timer_, __LINE__)(timer)
+
+#else
+
+#define STATS_COUNT(counter, n) ((void)0)
+#define STATS_TIME(timer) ((void)0)
+
+#endif
+
+#endif // STATS_H
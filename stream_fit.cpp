@@ -0,0 +1,305 @@
+#include "stream_fit.h"
+#include "interpolation.h"
+#include "interpolation_file.h"
+#include "segment_table.h"
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+stream_fitter::stream_fitter(size_t chunk) : chunk(chunk > 0 ? chunk : 1)
+{
+    for (FILE *&f : spill) {
+        f = tmpfile();
+        if (!f) {
+            status = file_io_error;
+        }
+    }
+}
+
+stream_fitter::~stream_fitter()
+{
+    for (FILE *f : spill) {
+        if (f) {
+            fclose(f);
+        }
+    }
+}
+
+double stream_fitter::bessel_slope(size_t i) const
+{
+    size_t j = i - base;
+    double h0 = x[j] - x[j - 1];
+    double h1 = x[j + 1] - x[j];
+    double tmp1 = (f_x[j] - f_x[j - 1]) / h0;
+    double tmp2 = (f_x[j + 1] - f_x[j]) / h1;
+    return (h1 * tmp1 + h0 * tmp2) / (h0 + h1);
+}
+
+double stream_fitter::end_slope(size_t first, size_t k, double point) const
+{
+    double lag_x[4];
+    double lag_f_x[4];
+    for (size_t i = 0; i < k; i++) {
+        lag_x[i] = x[first + i - base];
+        lag_f_x[i] = f_x[first + i - base];
+    }
+    return interpolation::end_slope(lag_x, lag_f_x, static_cast<int>(k),
+                                    point);
+}
+
+// Solves rows [lo, hi) of the slope system for spline_d, with spline_d at
+// lo - 1 already final and right taken as the slope at hi.
+void stream_fitter::solve_window(size_t lo, size_t hi, double right)
+{
+    if (hi <= lo) {
+        return;
+    }
+
+    int m = static_cast<int>(hi - lo);
+    low_diag.resize(m);
+    diag.resize(m);
+    up_diag.resize(m);
+
+    for (int r = 0; r < m; r++) {
+        size_t j = lo + r - base;
+        double h0 = x[j] - x[j - 1];
+        double h1 = x[j + 1] - x[j];
+        if (r > 0) {
+            low_diag[r - 1] = h1;
+        }
+        diag[r] = 2. * (h0 + h1);
+        up_diag[r] = h0;
+        spline_d[j] = 3. * (h1 * (f_x[j] - f_x[j - 1]) / h0 +
+                            h0 * (f_x[j + 1] - f_x[j]) / h1);
+        if (r == 0) {
+            spline_d[j] -= h1 * spline_d[j - 1];
+        }
+        if (r == m - 1) {
+            spline_d[j] -= h0 * right;
+        }
+    }
+
+    window_lu.factor(low_diag, diag, up_diag, m, 1);
+    window_lu.solve(spline_d.data() + (lo - base));
+}
+
+// Finalizes slopes, nodes and segments up to node end, or all of them when
+// last is set.
+void stream_fitter::flush(size_t end, bool last)
+{
+    size_t n = count;
+    size_t from = done > 0 ? done : 1;
+    if (last) {
+        end = n;
+    }
+    size_t interior_end = last ? n - 1 : end;
+
+    for (size_t i = from; i < interior_end; i++) {
+        d[i - base] = bessel_slope(i);
+    }
+
+    // The second derivative at the ends is estimated by the second divided
+    // difference of the three outermost samples. d[0] needs d[1], which a
+    // one-node first chunk leaves to the next flush.
+    if (from == 1 && interior_end > 1) {
+        double h0 = x[1] - x[0];
+        double h1 = x[2] - x[1];
+        double tmp = (f_x[1] - f_x[0]) / h0;
+        double der2 =
+            2. * ((f_x[2] - f_x[1]) / h1 - tmp) / (h0 + h1);
+        d[0] = 0.5 * (3 * tmp - d[1] - 0.5 * der2 * h0);
+    }
+    if (done == 0) {
+        spline_d[0] = end_slope(0, n < 4 ? n : 4, x[0]);
+    }
+    if (last) {
+        size_t j = n - 1 - base;
+        double h0 = x[j] - x[j - 1];
+        double h1 = x[j - 1] - x[j - 2];
+        double tmp = (f_x[j] - f_x[j - 1]) / h0;
+        double der2 =
+            2. * (tmp - (f_x[j - 1] - f_x[j - 2]) / h1) / (h0 + h1);
+        d[j] = 0.5 * (3 * tmp - d[j - 1] + 0.5 * der2 * h0);
+
+        size_t k = n < 4 ? n : 4;
+        spline_d[j] = end_slope(n - k, k, x[j]);
+        solve_window(from, n - 1, spline_d[j]);
+    } else {
+        size_t hi = end + spline_overlap;
+        solve_window(from, hi, bessel_slope(hi));
+    }
+
+    size_t nodes = end - done;
+    if (fwrite(&x[done - base], sizeof(double), nodes, spill[0]) != nodes ||
+        fwrite(&f_x[done - base], sizeof(double), nodes, spill[1]) !=
+            nodes) {
+        status = file_io_error;
+    }
+    for (size_t i = emitted; i + 1 < end; i++) {
+        size_t j = i - base;
+        double h = x[j + 1] - x[j];
+        double tmp = (f_x[j + 1] - f_x[j]) / h;
+        segment bessel =
+            make_segment(x[j], h, f_x[j], d[j],
+                         (3 * tmp - 2 * d[j] - d[j + 1]) / h,
+                         (d[j] + d[j + 1] - 2 * tmp) / h / h);
+        segment spline = make_segment(
+            x[j], h, f_x[j], spline_d[j],
+            (3. * tmp - 2. * spline_d[j] - spline_d[j + 1]) / h,
+            (spline_d[j] + spline_d[j + 1] - 2. * tmp) / h / h);
+        if (fwrite(&bessel, sizeof(segment), 1, spill[2]) != 1 ||
+            fwrite(&spline, sizeof(segment), 1, spill[3]) != 1) {
+            status = file_io_error;
+            break;
+        }
+    }
+    emitted = end - 1;
+    done = end;
+
+    if (last) {
+        return;
+    }
+
+    // Node done - 1 stays as the left neighbour of the next chunk.
+    size_t drop = done - 1 - base;
+    x.erase(x.begin(), x.begin() + drop);
+    f_x.erase(f_x.begin(), f_x.begin() + drop);
+    d.erase(d.begin(), d.begin() + drop);
+    spline_d.erase(spline_d.begin(), spline_d.begin() + drop);
+    base = done - 1;
+}
+
+int stream_fitter::push(double new_x, double new_f_x)
+{
+    if (status != file_ok) {
+        return status;
+    }
+
+    if (count == 0) {
+        a = new_x;
+    } else {
+        double h = new_x - x.back();
+        if (!(h > 0.)) {
+            status = file_data_error;
+            return status;
+        }
+        if (count == 1) {
+            step = h;
+        } else if (fabs(h - step) > 1e-12 * step) {
+            uniform = false;
+        }
+    }
+
+    x.push_back(new_x);
+    f_x.push_back(new_f_x);
+    d.push_back(0.);
+    spline_d.push_back(0.);
+    count++;
+
+    if (count >= done + chunk + spline_overlap + 2) {
+        flush(done + chunk, false);
+    }
+    return status;
+}
+
+int stream_fitter::finish(const char *path)
+{
+    if (status != file_ok) {
+        return status;
+    }
+    if (count < 3) {
+        status = file_format_error;
+        return status;
+    }
+
+    flush(count, true);
+    if (status != file_ok) {
+        return status;
+    }
+
+    interpolation_file_header header =
+        make_file_header(a, x.back(), count, data_func_id, uniform);
+    status = save_interpolation(header, spill[0], spill[1], spill[2],
+                                spill[3], path);
+    return status;
+}
+
+static int ingest_binary(FILE *in, stream_fitter &fitter)
+{
+    if (__BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__) {
+        return file_endian_error;
+    }
+
+    double buffer[2 * 4096];
+    size_t got;
+    while ((got = fread(buffer, sizeof(double), 2 * 4096, in)) > 0) {
+        if (got % 2 != 0) {
+            return file_data_error;
+        }
+        for (size_t k = 0; k < got; k += 2) {
+            int status = fitter.push(buffer[k], buffer[k + 1]);
+            if (status != file_ok) {
+                return status;
+            }
+        }
+    }
+    return ferror(in) ? file_io_error : file_ok;
+}
+
+static int ingest_csv(FILE *in, stream_fitter &fitter)
+{
+    char line[1024];
+    bool header_allowed = true;
+
+    while (fgets(line, sizeof(line), in)) {
+        if (!strchr(line, '\n') && !feof(in)) {
+            return file_data_error;
+        }
+
+        char *p = line;
+        while (*p == ' ' || *p == '\t') {
+            p++;
+        }
+        if (*p == '\0' || *p == '\n' || *p == '\r' || *p == '#') {
+            continue;
+        }
+
+        char *end;
+        double new_x = strtod(p, &end);
+        bool parsed = end != p;
+        p = end;
+        while (*p == ' ' || *p == '\t' || *p == ',' || *p == ';') {
+            p++;
+        }
+        double new_f_x = strtod(p, &end);
+        parsed = parsed && end != p;
+
+        if (!parsed) {
+            if (header_allowed) {
+                header_allowed = false;
+                continue;
+            }
+            return file_data_error;
+        }
+        header_allowed = false;
+
+        int status = fitter.push(new_x, new_f_x);
+        if (status != file_ok) {
+            return status;
+        }
+    }
+    return ferror(in) ? file_io_error : file_ok;
+}
+
+int ingest_samples(FILE *in, sample_format format, const char *path,
+                   size_t chunk)
+{
+    stream_fitter fitter(chunk);
+
+    int status = format == sample_format::binary ? ingest_binary(in, fitter)
+                                                 : ingest_csv(in, fitter);
+    if (status != file_ok) {
+        return status;
+    }
+    return fitter.finish(path);
+}
@@ -0,0 +1,81 @@
+#ifndef STREAM_FIT_H
+#define STREAM_FIT_H
+
+#include "tridiagonal.h"
+#include <cstddef>
+#include <cstdio>
+#include <vector>
+
+enum class sample_format {
+    // One "x y" pair per line, separated by ',', ';' or blanks. Blank lines,
+    // lines starting with '#' and a leading non-numeric header are skipped.
+    csv,
+    // Little-endian double pairs x, y.
+    binary,
+};
+
+// Fits (x, y) samples arriving in increasing x order with memory bounded by
+// the chunk size, and writes the fit in the interpolation_file format.
+//
+// Bessel slopes need only the neighbours of a node. Spline slopes are solved
+// window by window: a window starts right after the last final slope, which
+// is its left boundary value, and ends spline_overlap rows past the chunk it
+// finalizes, at a Bessel estimate of the slope. Every row of the slope system
+// is diagonally dominant by at least a factor of 2, so the error of that
+// estimate shrinks at least by half per row and is far below rounding at the
+// chunk. Nodes and segments are spilled to temporary files as they are
+// finalized.
+class stream_fitter
+{
+  private:
+    size_t chunk;
+    int status = 0;
+    // Samples pushed, global index of the first buffered node, slopes final
+    // for [0, done) and segments written.
+    size_t count = 0;
+    size_t base = 0;
+    size_t done = 0;
+    size_t emitted = 0;
+    double a = 0.;
+    double step = 0.;
+    bool uniform = true;
+
+    // Nodes [base, count): samples, Bessel and spline slopes.
+    std::vector<double> x;
+    std::vector<double> f_x;
+    std::vector<double> d;
+    std::vector<double> spline_d;
+
+    // Scratch for the window systems.
+    std::vector<double> low_diag;
+    std::vector<double> diag;
+    std::vector<double> up_diag;
+    tridiagonal_lu window_lu;
+
+    // x, f_x, Bessel and spline segment spill files.
+    FILE *spill[4] = {};
+
+    double bessel_slope(size_t i) const;
+    double end_slope(size_t first, size_t k, double point) const;
+    void solve_window(size_t lo, size_t hi, double right);
+    void flush(size_t end, bool last);
+
+  public:
+    static const int spline_overlap = 64;
+
+    explicit stream_fitter(size_t chunk = 1 << 16);
+    ~stream_fitter();
+    stream_fitter(const stream_fitter &) = delete;
+    stream_fitter &operator=(const stream_fitter &) = delete;
+
+    // Return file_ok or a negative interpolation_file_status; samples out
+    // of x order give file_data_error. After an error every call fails.
+    int push(double new_x, double new_f_x);
+    int finish(const char *path);
+};
+
+// Reads all samples of in and writes their fit to path.
+int ingest_samples(FILE *in, sample_format format, const char *path,
+                   size_t chunk = 1 << 16);
+
+#endif // STREAM_FIT_H
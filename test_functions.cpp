@@ -0,0 +1,138 @@
+#include "test_functions.h"
+#include "interpolation_view.h"
+#include <atomic>
+#include <cmath>
+#include <mutex>
+
+// |f| is largest at the end of [a, b] farthest from 0 for the powers of x.
+static double max_abs_at_far_end(double (*f)(double), double a, double b)
+{
+    return fabs(a) > fabs(b) ? fabs(f(a)) : fabs(f(b));
+}
+
+struct constant_function {
+    static constexpr const char *name = "f(x) = 1";
+    static double value(double) { return 1.; }
+    static double second_derivative(double) { return 0.; }
+    static double max_abs(double, double) { return 1.; }
+};
+
+struct linear_function {
+    static constexpr const char *name = "f(x) = x";
+    static double value(double x) { return x; }
+    static double second_derivative(double) { return 0.; }
+    static double max_abs(double a, double b)
+    {
+        return max_abs_at_far_end(value, a, b);
+    }
+};
+
+struct square_function {
+    static constexpr const char *name = "f(x) = x^2";
+    static double value(double x) { return x * x; }
+    static double second_derivative(double) { return 2.; }
+    static double max_abs(double a, double b)
+    {
+        return max_abs_at_far_end(value, a, b);
+    }
+};
+
+struct cube_function {
+    static constexpr const char *name = "f(x) = x^3";
+    static double value(double x) { return x * x * x; }
+    static double second_derivative(double x) { return 6. * x; }
+    static double max_abs(double a, double b)
+    {
+        return max_abs_at_far_end(value, a, b);
+    }
+};
+
+struct fourth_power_function {
+    static constexpr const char *name = "f(x) = x^4";
+    static double value(double x) { return x * x * x * x; }
+    static double second_derivative(double x) { return 12. * x * x; }
+    static double max_abs(double a, double b)
+    {
+        return max_abs_at_far_end(value, a, b);
+    }
+};
+
+struct exp_function {
+    static constexpr const char *name = "f(x) = e^x";
+    static double value(double x) { return exp(x); }
+    static double second_derivative(double x) { return exp(x); }
+    static double max_abs(double, double b) { return exp(b); }
+};
+
+struct runge_function {
+    static constexpr const char *name = "f(x) = 1/(25x^2 + 1)";
+    static double value(double x) { return 1. / (25. * x * x + 1.); }
+    static double second_derivative(double x)
+    {
+        double q = 25. * x * x + 1.;
+        return -50. / q / q + 5000 * x * x / q / q / q;
+    }
+    // Decreasing in |x|: the maximum is at 0 or at the end nearer to it.
+    static double max_abs(double a, double b)
+    {
+        if (a * b < 0) {
+            return 1.;
+        }
+        return fabs(a) < fabs(b) ? value(a) : value(b);
+    }
+};
+
+static const int max_functions = 64;
+
+static test_function functions[max_functions] = {
+    make_test_function<constant_function>(),
+    make_test_function<linear_function>(),
+    make_test_function<square_function>(),
+    make_test_function<cube_function>(),
+    make_test_function<fourth_power_function>(),
+    make_test_function<exp_function>(),
+    make_test_function<runge_function>(),
+};
+static std::atomic<int> registered(builtin_function_count);
+static std::mutex register_mutex;
+
+int register_function(const test_function &f)
+{
+    if (!f.value || !f.values) {
+        return invalid_func_id;
+    }
+
+    std::lock_guard<std::mutex> lock(register_mutex);
+    int id = registered.load(std::memory_order_relaxed);
+    if (id == max_functions) {
+        return invalid_func_id;
+    }
+    functions[id] = f;
+    registered.store(id + 1, std::memory_order_release);
+    return id;
+}
+
+const test_function *find_function(int func_id)
+{
+    if (func_id < 0 || func_id >= registered.load(std::memory_order_acquire)) {
+        return nullptr;
+    }
+    return &functions[func_id];
+}
+
+int function_count()
+{
+    return registered.load(std::memory_order_acquire);
+}
+
+double func(int func_id, double x)
+{
+    const test_function *f = find_function(func_id);
+    return f ? f->value(x) : 0.;
+}
+
+double func_2derivative(int func_id, double x)
+{
+    const test_function *f = find_function(func_id);
+    return f && f->second_derivative ? f->second_derivative(x) : 0.;
+}
@@ -0,0 +1,62 @@
+#ifndef TEST_FUNCTIONS_H
+#define TEST_FUNCTIONS_H
+
+#include <cstddef>
+
+// A function to interpolate: its value, the second derivative used by the
+// Bessel end slopes, the maximum of |f| on [a, b] that scales the
+// disturbance, and a display name. values() fills a whole array through a
+// single indirect call. second_derivative and max_abs may be null; they are
+// then taken as 0 and estimated from samples.
+struct test_function {
+    const char *name;
+    double (*value)(double x);
+    double (*second_derivative)(double x);
+    double (*max_abs)(double a, double b);
+    void (*values)(const double *xs, double *out, size_t count);
+};
+
+template <typename F>
+void functor_values(const double *xs, double *out, size_t count)
+{
+    for (size_t k = 0; k < count; k++) {
+        out[k] = F::value(xs[k]);
+    }
+}
+
+// Builds the entry of a functor with static value, second_derivative and
+// max_abs members and a static constexpr name. The batch loop is
+// instantiated for F, so F::value is inlined into it:
+//
+//     struct sine {
+//         static constexpr const char *name = "f(x) = sin(x)";
+//         static double value(double x) { return sin(x); }
+//         static double second_derivative(double x) { return -sin(x); }
+//         static double max_abs(double, double) { return 1.; }
+//     };
+//     int id = register_function(make_test_function<sine>());
+template <typename F> constexpr test_function make_test_function()
+{
+    return {F::name, F::value, F::second_derivative, F::max_abs,
+            functor_values<F>};
+}
+
+// func_id 0 .. builtin_function_count - 1 are the built-in functions.
+const int builtin_function_count = 7;
+// func_id of fits of measured samples rather than of a registered function.
+const int data_func_id = -1;
+// Returned by register_function on failure; never a valid func_id.
+const int invalid_func_id = -2;
+
+// Adds f and returns its func_id, or invalid_func_id when f has no value
+// or values pointer or the registry is full.
+// Registration may run while other threads evaluate; entries are never
+// removed or changed.
+int register_function(const test_function &f);
+// nullptr for an unknown func_id.
+const test_function *find_function(int func_id);
+int function_count();
+
+double func_2derivative(int func_id, double x);
+
+#endif // TEST_FUNCTIONS_H
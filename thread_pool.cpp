@@ -0,0 +1,84 @@
+#include "thread_pool.h"
+
+thread_pool::thread_pool(int threads) : next_task(0)
+{
+    if (threads <= 0) {
+        threads = static_cast<int>(std::thread::hardware_concurrency());
+    }
+    for (int k = 1; k < threads; k++) {
+        workers.emplace_back(&thread_pool::worker_loop, this);
+    }
+}
+
+thread_pool::~thread_pool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread &t : workers) {
+        t.join();
+    }
+}
+
+void thread_pool::drain(const std::function<void(size_t)> &work,
+                        size_t count)
+{
+    for (size_t i = next_task.fetch_add(1, std::memory_order_relaxed);
+         i < count; i = next_task.fetch_add(1, std::memory_order_relaxed)) {
+        work(i);
+    }
+}
+
+// Each worker joins every job exactly once: run() waits for all of them
+// before the next generation can start.
+void thread_pool::worker_loop()
+{
+    unsigned seen = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        wake.wait(lock, [&]() { return stopping || generation != seen; });
+        if (stopping) {
+            return;
+        }
+        seen = generation;
+        const std::function<void(size_t)> *work = task;
+        size_t count = task_count;
+
+        lock.unlock();
+        drain(*work, count);
+        lock.lock();
+
+        if (--busy == 0) {
+            finished.notify_one();
+        }
+    }
+}
+
+void thread_pool::run(size_t count, const std::function<void(size_t)> &work)
+{
+    if (workers.empty() || count < 2) {
+        for (size_t i = 0; i < count; i++) {
+            work(i);
+        }
+        return;
+    }
+
+    std::lock_guard<std::mutex> run_lock(run_mutex);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        task = &work;
+        task_count = count;
+        next_task.store(0, std::memory_order_relaxed);
+        busy = static_cast<int>(workers.size());
+        generation++;
+    }
+    wake.notify_all();
+
+    drain(work, count);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [&]() { return busy == 0; });
+    task = nullptr;
+}
@@ -0,0 +1,52 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads that run indexed tasks. The threads start
+// once and sleep between jobs, so a job costs one wake-up instead of a
+// thread creation per part. Tasks are handed out one index at a time from a
+// shared counter: a thread that finishes early takes the next index, which
+// balances uneven tasks without per-thread queues.
+class thread_pool
+{
+  private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    // Serializes run() calls from different threads.
+    std::mutex run_mutex;
+
+    const std::function<void(size_t)> *task = nullptr;
+    size_t task_count = 0;
+    std::atomic<size_t> next_task;
+    unsigned generation = 0;
+    int busy = 0;
+    bool stopping = false;
+
+    void worker_loop();
+    void drain(const std::function<void(size_t)> &work, size_t count);
+
+  public:
+    // threads = 0 uses one thread per hardware thread. The thread that
+    // calls run() is one of them.
+    explicit thread_pool(int threads = 0);
+    ~thread_pool();
+    thread_pool(const thread_pool &) = delete;
+    thread_pool &operator=(const thread_pool &) = delete;
+
+    int size() const { return static_cast<int>(workers.size()) + 1; }
+
+    // Calls work(i) for every i in [0, count) and returns when all calls
+    // are done. work must not call run() on the same pool.
+    void run(size_t count, const std::function<void(size_t)> &work);
+};
+
+#endif // THREAD_POOL_H
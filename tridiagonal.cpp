@@ -0,0 +1,172 @@
+#include "tridiagonal.h"
+#include <cstddef>
+#include <thread>
+
+// Thomas elimination of an m-row block. c[m - 1] couples the block to the
+// row after it and is left untouched.
+static void factor_block(const double *d, double *a, double *c, int m)
+{
+    for (int k = 0; k < m - 1; k++) {
+        c[k] /= a[k];
+        a[k + 1] -= d[k] * c[k];
+    }
+}
+
+static void substitute_block(const double *d, const double *a, const double *c,
+                             double *x, int m, int count)
+{
+    for (int j = 0; j < count; j++) {
+        x[j] /= a[0];
+    }
+    for (int k = 1; k < m; k++) {
+        double *row = x + static_cast<size_t>(k) * count;
+        const double *prev = row - count;
+        for (int j = 0; j < count; j++) {
+            row[j] = (row[j] - d[k - 1] * prev[j]) / a[k];
+        }
+    }
+    for (int k = m - 2; k >= 0; k--) {
+        double *row = x + static_cast<size_t>(k) * count;
+        const double *next = row + count;
+        for (int j = 0; j < count; j++) {
+            row[j] -= c[k] * next[j];
+        }
+    }
+}
+
+template <class Work>
+static void run_blocks(int parts, const Work &work)
+{
+    std::vector<std::thread> threads;
+    for (int k = 0; k < parts; k++) {
+        threads.emplace_back(work, k);
+    }
+    for (std::thread &t : threads) {
+        t.join();
+    }
+}
+
+void tridiagonal_lu::factor(const std::vector<double> &d,
+                            const std::vector<double> &a,
+                            const std::vector<double> &c, int new_n,
+                            int new_parts)
+{
+    n = new_n;
+    low.assign(d.begin(), d.begin() + n);
+    diag.assign(a.begin(), a.begin() + n);
+    up.assign(c.begin(), c.begin() + n);
+
+    parts = new_parts;
+    if (parts <= 0) {
+        parts = static_cast<int>(std::thread::hardware_concurrency());
+    }
+    if (parts > n / min_block) {
+        parts = n / min_block;
+    }
+    if (parts < 2) {
+        parts = 1;
+        factor_block(low.data(), diag.data(), up.data(), n);
+        return;
+    }
+
+    start.resize(parts + 1);
+    for (int k = 0; k < parts; k++) {
+        start[k] = static_cast<int>(static_cast<long long>(n) * k / parts);
+    }
+    start[parts] = n + 1;
+
+    v.assign(n, 0.);
+    w.assign(n, 0.);
+
+    run_blocks(parts, [this](int k) {
+        int s = start[k];
+        int m = start[k + 1] - 1 - s;
+        factor_block(low.data() + s, diag.data() + s, up.data() + s, m);
+        if (k > 0) {
+            v[s] = -low[s - 1];
+            substitute_block(low.data() + s, diag.data() + s, up.data() + s,
+                             v.data() + s, m, 1);
+        }
+        if (k < parts - 1) {
+            w[s + m - 1] = -up[s + m - 1];
+            substitute_block(low.data() + s, diag.data() + s, up.data() + s,
+                             w.data() + s, m, 1);
+        }
+    });
+
+    int m = parts - 1;
+    red_low.assign(m, 0.);
+    red_diag.resize(m);
+    red_up.assign(m, 0.);
+
+    for (int k = 0; k < m; k++) {
+        int r = start[k + 1] - 1;
+        red_diag[k] = diag[r] + low[r - 1] * w[r - 1] + up[r] * v[r + 1];
+        if (k > 0) {
+            red_low[k - 1] = low[r - 1] * v[r - 1];
+        }
+        red_up[k] = up[r] * w[r + 1];
+    }
+
+    factor_block(red_low.data(), red_diag.data(), red_up.data(), m);
+}
+
+void tridiagonal_lu::solve(double *b) const
+{
+    solve_many(b, 1);
+}
+
+void tridiagonal_lu::solve_many(double *b, int count) const
+{
+    if (parts == 1) {
+        substitute_block(low.data(), diag.data(), up.data(), b, n, count);
+        return;
+    }
+
+    run_blocks(parts, [this, b, count](int k) {
+        int s = start[k];
+        int m = start[k + 1] - 1 - s;
+        substitute_block(low.data() + s, diag.data() + s, up.data() + s,
+                         b + static_cast<size_t>(s) * count, m, count);
+    });
+
+    int m = parts - 1;
+    z.resize(static_cast<size_t>(m) * count);
+    for (int k = 0; k < m; k++) {
+        int r = start[k + 1] - 1;
+        const double *row = b + static_cast<size_t>(r) * count;
+        for (int j = 0; j < count; j++) {
+            z[k * count + j] = row[j] - low[r - 1] * row[j - count] -
+                               up[r] * row[j + count];
+        }
+    }
+
+    substitute_block(red_low.data(), red_diag.data(), red_up.data(), z.data(),
+                     m, count);
+
+    run_blocks(parts, [this, b, count](int k) {
+        int s = start[k];
+        int e = start[k + 1] - 1;
+        if (k > 0) {
+            const double *z_left = z.data() + (k - 1) * count;
+            for (int i = s; i < e; i++) {
+                double *row = b + static_cast<size_t>(i) * count;
+                for (int j = 0; j < count; j++) {
+                    row[j] += v[i] * z_left[j];
+                }
+            }
+        }
+        if (k < parts - 1) {
+            const double *z_right = z.data() + k * count;
+            for (int i = s; i < e; i++) {
+                double *row = b + static_cast<size_t>(i) * count;
+                for (int j = 0; j < count; j++) {
+                    row[j] += w[i] * z_right[j];
+                }
+            }
+            for (int j = 0; j < count; j++) {
+                b[static_cast<size_t>(e) * count + j] = z_right[j];
+            }
+        }
+    });
+}
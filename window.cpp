@@ -1,47 +1,49 @@
+#include <QMetaObject>
 #include <QPainter>
 #include <iostream>
 #include <sstream>
 #include <stdio.h>
 #include <string>
+#include <vector>
 
 #include "interpolation.h"
+#include "stats.h"
+#include "test_functions.h"
 #include "window.h"
 
 #define DEFAULT_A -10
 #define DEFAULT_B 10
 #define DEFAULT_N 10
 
-void Window::func_name()
+static void sample_abscissae(double a, double b, int columns,
+                             std::vector<double> &xs)
 {
-    switch (func_id) {
-    case 0:
-        f_name = "f(x) = 1";
-        break;
-    case 1:
-        f_name = "f(x) = x";
-        break;
-    case 2:
-        f_name = "f(x) = x^2";
-        break;
-    case 3:
-        f_name = "f(x) = x^3";
-        break;
-    case 4:
-        f_name = "f(x) = x^4";
-        break;
-    case 5:
-        f_name = "f(x) = e^x";
-        break;
-    case 6:
-        f_name = "f(x) = 1/(25x^2 + 1)";
-        break;
-    default:
-        f_name = "";
+    double delta_x = (b - a) / columns;
+    double eps = 1e-14;
+
+    xs.clear();
+    for (double x = a; x - b < eps; x += delta_x) {
+        xs.push_back(x);
     }
+    xs.push_back(b);
+}
+
+static std::string format_error(double error)
+{
+    char text[32];
+    snprintf(text, sizeof(text), "%.3e", error);
+    return text;
+}
+
+void Window::func_name()
+{
+    const test_function *fn = find_function(func_id);
+    f_name = fn ? fn->name : "";
 }
 
 Window::Window(QWidget *parent, QLabel *log_lab, QLabel *method_lab)
-    : QWidget(parent), log_label(log_lab), method_label(method_lab)
+    : QWidget(parent), log_label(log_lab), method_label(method_lab),
+      cancel_refit(false)
 {
     a = DEFAULT_A;
     b = DEFAULT_B;
@@ -49,6 +51,8 @@ Window::Window(QWidget *parent, QLabel *log_lab, QLabel *method_lab)
 
     func_id = 0;
     func_name();
+
+    worker = std::thread(&Window::worker_loop, this);
 }
 
 QSize Window::minimumSizeHint() const
@@ -72,27 +76,151 @@ int Window::parse_command_line(int argc, char *argv[])
         return 1;
     }
 
-    f = new interpolation(a, b, n, func_id);
+    request_refit();
 
     return 0;
 }
 
 Window::~Window()
 {
-    if (f) {
-        delete f;
+    {
+        std::lock_guard<std::mutex> lock(worker_mutex);
+        stopping = true;
+        cancel_refit.store(true);
     }
+    worker_cv.notify_one();
+    worker.join();
 }
 
-void Window::change_func()
+void Window::request_refit()
 {
-    func_id = (func_id + 1) % 7;
-    f->change_func(func_id);
-    func_name();
+    generation++;
+    {
+        std::lock_guard<std::mutex> lock(worker_mutex);
+        pending.a = a;
+        pending.b = b;
+        pending.n = n;
+        pending.func_id = func_id;
+        pending.disturb = disturb;
+        pending.width = width();
+        pending.generation = generation;
+        has_request = true;
+        cancel_refit.store(true);
+    }
+    worker_cv.notify_one();
+}
+
+void Window::worker_loop()
+{
+    for (;;) {
+        refit_request request;
+        {
+            std::unique_lock<std::mutex> lock(worker_mutex);
+            worker_cv.wait(lock, [this] { return stopping || has_request; });
+            if (stopping) {
+                return;
+            }
+            request = pending;
+            has_request = false;
+            cancel_refit.store(false);
+        }
+
+        if (request.n > preview_n) {
+            run_refit(request, preview_n);
+        }
+        if (!cancel_refit.load()) {
+            run_refit(request, request.n);
+        }
+    }
+}
+
+void Window::run_refit(const refit_request &request, int nodes)
+{
+    std::shared_ptr<refit_result> result = std::make_shared<refit_result>();
+    result->generation = request.generation;
+    result->preview = nodes != request.n;
+    result->width = request.width;
+    result->f = std::make_shared<interpolation>(
+        request.a, request.b, nodes, request.func_id, &cancel_refit);
+    if (cancel_refit.load()) {
+        return;
+    }
+    result->f->set_disturb(request.disturb);
+
+    int points = norm_points / nodes;
+    result->has_errors =
+        measure_errors(pool, result->f->view(), points > 0 ? points : 1,
+                       result->errors, &cancel_refit);
+    if (cancel_refit.load()) {
+        return;
+    }
+
+    int columns = request.width;
+    sample_abscissae(request.a, request.b, columns, result->x);
+    interpolation_view view = result->f->view();
+    for (int k = 0; k < curve_count; k++) {
+        if (cancel_refit.load()) {
+            return;
+        }
+        interpolation_method type = static_cast<interpolation_method>(k);
+        if (nodes - 1 > columns && (type == interpolation_method::bessel ||
+                                    type == interpolation_method::spline)) {
+            std::shared_ptr<envelope_pyramid> pyramid =
+                std::make_shared<envelope_pyramid>();
+            pyramid->build(type == interpolation_method::bessel
+                               ? view.bessel_coeffs
+                               : view.spline_coeffs);
+            result->lows[k].resize(request.width);
+            result->highs[k].resize(request.width);
+            pyramid->envelope(request.a, request.b, request.width,
+                              result->lows[k].data(),
+                              result->highs[k].data());
+            result->pyramids[k] = pyramid;
+            continue;
+        }
+        result->samples[k].resize(result->x.size());
+        result->f->evaluate(result->x.data(), result->samples[k].data(),
+                            result->x.size(), type);
+    }
+
+    QMetaObject::invokeMethod(
+        this, [this, result]() { apply_refit(result); },
+        Qt::QueuedConnection);
+}
+
+void Window::apply_refit(const std::shared_ptr<refit_result> &result)
+{
+    if (result->generation != generation) {
+        return;
+    }
+
+    f = result->f;
+    shown_a = f->view().a;
+    shown_b = f->view().b;
+    preview = result->preview;
+    errors = result->errors;
+    has_errors = result->has_errors;
+    shown_generation = result->generation;
+    sample_x.swap(result->x);
+    for (int k = 0; k < curve_count; k++) {
+        samples[k].swap(result->samples[k]);
+        pyramids[k] = result->pyramids[k];
+        lows[k].swap(result->lows[k]);
+        highs[k].swap(result->highs[k]);
+        sampled[k] = true;
+    }
+    sampled_width = result->width;
 
     update();
 }
 
+void Window::change_func()
+{
+    func_id = (func_id + 1) % function_count();
+    func_name();
+    request_refit();
+}
+
 void Window::change_method()
 {
     switch (method) {
@@ -118,9 +246,7 @@ void Window::increase_scale()
     a /= 2;
     b /= 2;
     scale /= 2;
-    f->increase_scale();
-
-    update();
+    request_refit();
 }
 
 void Window::decrease_scale()
@@ -128,43 +254,35 @@ void Window::decrease_scale()
     a *= 2;
     b *= 2;
     scale *= 2;
-    f->decrease_scale();
-
-    update();
+    request_refit();
 }
 
 void Window::increase_n()
 {
-    n *= 2;
-    f->change_n(n);
-
-    update();
+    if (n <= n_max / 2) {
+        n *= 2;
+        request_refit();
+    }
 }
 
 void Window::decrease_n()
 {
     if (n > 3) {
         n /= 2;
-        f->change_n(n);
+        request_refit();
     }
-
-    update();
 }
 
 void Window::increase_disturb()
 {
     disturb++;
-    f->increase_disturb();
-
-    update();
+    request_refit();
 }
 
 void Window::decrease_disturb()
 {
     disturb--;
-    f->decrease_disturb();
-
-    update();
+    request_refit();
 }
 
 void Window::change_label(double y_min, double y_max)
@@ -179,7 +297,21 @@ void Window::change_label(double y_min, double y_max)
     log_lab = log_lab + "|f(x)| = " + std::to_string(f_max) + "\n";
     log_lab = log_lab + "scale = " + std::to_string(scale) + "\n";
     log_lab = log_lab + "n = " + std::to_string(n) + "\n";
+    if (preview) {
+        log_lab = log_lab + "preview n = " + std::to_string(preview_n) + "\n";
+    }
     log_lab = log_lab + "disturbance = " + std::to_string(disturb) + "\n";
+    if (has_errors) {
+        log_lab = log_lab + "bessel: max " +
+                  format_error(errors.bessel.max_error) + ", L2 " +
+                  format_error(errors.bessel.l2_error) + "\n";
+        log_lab = log_lab + "spline: max " +
+                  format_error(errors.spline.max_error) + ", L2 " +
+                  format_error(errors.spline.l2_error) + "\n";
+    }
+    if (stats_enabled()) {
+        log_lab = log_lab + stats_report();
+    }
 
     log_label->setText(QString::fromStdString(log_lab));
 
@@ -211,7 +343,7 @@ void Window::change_label(double y_min, double y_max)
 QPointF Window::local2global(double x_loc, double y_loc, double y_min,
                              double y_max)
 {
-    double x_global = (x_loc - a) / (b - a) * width();
+    double x_global = (x_loc - shown_a) / (shown_b - shown_a) * width();
     double y_global = (y_max - y_loc) / (y_max - y_min) * height();
     return QPointF(x_global, y_global);
 }
@@ -224,8 +356,8 @@ void Window::draw_axes(QPainter &painter, double min, double max)
     painter.setPen(pen);
 
     QLineF x_axe;
-    x_axe.setP1(local2global(a, 0, min, max));
-    x_axe.setP2(local2global(b, 0, min, max));
+    x_axe.setP1(local2global(shown_a, 0, min, max));
+    x_axe.setP2(local2global(shown_b, 0, min, max));
 
     QLineF y_axe;
     y_axe.setP1(local2global(0, min, min, max));
@@ -235,9 +367,8 @@ void Window::draw_axes(QPainter &painter, double min, double max)
     painter.drawLine(y_axe);
 }
 
-void Window::draw_func(QPainter &painter, interpolation *f,
-                       interpolation_method method, double y_min, double y_max,
-                       double delta_x)
+void Window::draw_func(QPainter &painter, interpolation_method method,
+                       double y_min, double y_max)
 {
     QPen pen;
     pen.setWidth(3);
@@ -261,94 +392,136 @@ void Window::draw_func(QPainter &painter, interpolation *f,
     }
     painter.setPen(pen);
 
-    QLineF line;
-    double x1 = a;
-    double y1 = f->get_value(x1, method);
-    double x2 = 0;
-    double y2 = 0;
+    if (pyramids[static_cast<int>(method)]) {
+        draw_envelope(painter, method, y_min, y_max);
+        return;
+    }
 
-    for (x2 = x1 + delta_x; x2 - b < eps; x2 += delta_x) {
-        y2 = f->get_value(x2, method);
+    const std::vector<double> &ys = curve(method);
+    size_t count = sample_x.size();
+    double x_scale = width() / (shown_b - shown_a);
+    double y_scale = height() / (y_max - y_min);
 
-        // local coords to global coords
-        line.setP1(local2global(x1, y1, y_min, y_max));
-        line.setP2(local2global(x2, y2, y_min, y_max));
+    // local coords to global coords
+    polyline.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        polyline[i] = QPointF((sample_x[i] - shown_a) * x_scale,
+                              (y_max - ys[i]) * y_scale);
+    }
+    painter.drawPolyline(polyline.data(), static_cast<int>(count));
+}
 
-        painter.drawLine(line);
-        x1 = x2;
-        y1 = y2;
+void Window::draw_envelope(QPainter &painter, interpolation_method method,
+                           double y_min, double y_max)
+{
+    sample(method);
+    int k = static_cast<int>(method);
+    size_t columns = lows[k].size();
+    double y_scale = height() / (y_max - y_min);
+
+    // Both extrema of every column, the one nearer to the previous point
+    // first, so that the polyline stays continuous between columns.
+    polyline.resize(2 * columns);
+    double last = lows[k].empty() ? 0. : lows[k][0];
+    for (size_t c = 0; c < columns; c++) {
+        double lo = lows[k][c];
+        double hi = highs[k][c];
+        if (fabs(hi - last) < fabs(lo - last)) {
+            std::swap(lo, hi);
+        }
+        polyline[2 * c] = QPointF(c, (y_max - lo) * y_scale);
+        polyline[2 * c + 1] = QPointF(c, (y_max - hi) * y_scale);
+        last = hi;
     }
+    painter.drawPolyline(polyline.data(), static_cast<int>(2 * columns));
+}
 
-    x2 = b;
-    y2 = f->get_value(x2, method);
+void Window::sample(interpolation_method type)
+{
+    int x_width = width();
+    if (x_width != sampled_width) {
+        sample_abscissae(shown_a, shown_b, x_width, sample_x);
+        for (bool &s : sampled) {
+            s = false;
+        }
+        sampled_width = x_width;
+    }
 
-    line.setP1(local2global(x1, y1, y_min, y_max));
-    line.setP2(local2global(x2, y2, y_min, y_max));
+    int k = static_cast<int>(type);
+    if (sampled[k]) {
+        return;
+    }
+    if (pyramids[k]) {
+        lows[k].resize(x_width);
+        highs[k].resize(x_width);
+        pyramids[k]->envelope(shown_a, shown_b, x_width, lows[k].data(),
+                              highs[k].data());
+    } else {
+        samples[k].resize(sample_x.size());
+        f->evaluate(sample_x.data(), samples[k].data(), sample_x.size(), type);
+    }
+    sampled[k] = true;
+}
 
-    painter.drawLine(line);
+const std::vector<double> &Window::curve(interpolation_method type)
+{
+    sample(type);
+    return samples[static_cast<int>(type)];
+}
+
+void Window::update_range(interpolation_method type, double &y_min,
+                          double &y_max)
+{
+    sample(type);
+    int k = static_cast<int>(type);
+    if (pyramids[k]) {
+        for (double y : lows[k]) {
+            y_min = fmin(y_min, y);
+        }
+        for (double y : highs[k]) {
+            y_max = fmax(y_max, y);
+        }
+        return;
+    }
+
+    for (double y : samples[k]) {
+        y_max = fmax(y_max, y);
+        y_min = fmin(y_min, y);
+    }
 }
 
 void Window::paintEvent(QPaintEvent *)
 {
+    if (!f) {
+        return;
+    }
+    STATS_TIME(stat_timer::paint);
+
     QPainter painter(this);
     double y_min;
     double y_max;
-    double delta_x;
     double delta_y;
-    double x;
-    double y;
-    int x_width = width();
 
-    delta_x = (b - a) / x_width;
     y_min = eps;
     y_max = -eps;
 
     // calculate min and max for current function
-    for (x = a; x - b < eps; x += delta_x) {
-        if (method == draw_method::bessel) {
-            if (n < f->n_bessel_max) {
-                y = f->get_value(x, interpolation_method::bessel);
-                y_max = fmax(y_max, y);
-                y_min = fmin(y_min, y);
-            }
-
-            y = f->get_value(x, interpolation_method::origin);
-            y_max = fmax(y_max, y);
-            y_min = fmin(y_min, y);
-        }
-        if (method == draw_method::spline) {
-            y = f->get_value(x, interpolation_method::spline);
-            y_max = fmax(y_max, y);
-            y_min = fmin(y_min, y);
-
-            y = f->get_value(x, interpolation_method::origin);
-            y_max = fmax(y_max, y);
-            y_min = fmin(y_min, y);
-        }
-        if (method == draw_method::both) {
-            if (n < f->n_bessel_max) {
-                y = f->get_value(x, interpolation_method::bessel);
-                y_max = fmax(y_max, y);
-                y_min = fmin(y_min, y);
-            }
-
-            y = f->get_value(x, interpolation_method::spline);
-            y_max = fmax(y_max, y);
-            y_min = fmin(y_min, y);
-
-            y = f->get_value(x, interpolation_method::origin);
-            y_max = fmax(y_max, y);
-            y_min = fmin(y_min, y);
-        }
-        if (method == draw_method::errors) {
-            y = f->get_value(x, interpolation_method::error_bessel);
-            y_max = fmax(y_max, y);
-            y_min = fmin(y_min, y);
-
-            y = f->get_value(x, interpolation_method::error_spline);
-            y_max = fmax(y_max, y);
-            y_min = fmin(y_min, y);
-        }
+    if (method == draw_method::bessel) {
+        update_range(interpolation_method::bessel, y_min, y_max);
+        update_range(interpolation_method::origin, y_min, y_max);
+    }
+    if (method == draw_method::spline) {
+        update_range(interpolation_method::spline, y_min, y_max);
+        update_range(interpolation_method::origin, y_min, y_max);
+    }
+    if (method == draw_method::both) {
+        update_range(interpolation_method::bessel, y_min, y_max);
+        update_range(interpolation_method::spline, y_min, y_max);
+        update_range(interpolation_method::origin, y_min, y_max);
+    }
+    if (method == draw_method::errors) {
+        update_range(interpolation_method::error_bessel, y_min, y_max);
+        update_range(interpolation_method::error_spline, y_min, y_max);
     }
 
     if (fabs(y_max - y_min) <= eps) {
@@ -364,33 +537,22 @@ void Window::paintEvent(QPaintEvent *)
 
     draw_axes(painter, y_min, y_max);
 
-    if (method == draw_method::bessel && n < f->n_bessel_max) {
-        draw_func(painter, f, interpolation_method::bessel, y_min, y_max,
-                  delta_x);
-        draw_func(painter, f, interpolation_method::origin, y_min, y_max,
-                  delta_x);
+    if (method == draw_method::bessel) {
+        draw_func(painter, interpolation_method::bessel, y_min, y_max);
+        draw_func(painter, interpolation_method::origin, y_min, y_max);
     }
     if (method == draw_method::spline) {
-        draw_func(painter, f, interpolation_method::spline, y_min, y_max,
-                  delta_x);
-        draw_func(painter, f, interpolation_method::origin, y_min, y_max,
-                  delta_x);
+        draw_func(painter, interpolation_method::spline, y_min, y_max);
+        draw_func(painter, interpolation_method::origin, y_min, y_max);
     }
     if (method == draw_method::both) {
-        if (n < f->n_bessel_max) {
-            draw_func(painter, f, interpolation_method::bessel, y_min, y_max,
-                      delta_x);
-        }
-        draw_func(painter, f, interpolation_method::spline, y_min, y_max,
-                  delta_x);
-        draw_func(painter, f, interpolation_method::origin, y_min, y_max,
-                  delta_x);
+        draw_func(painter, interpolation_method::bessel, y_min, y_max);
+        draw_func(painter, interpolation_method::spline, y_min, y_max);
+        draw_func(painter, interpolation_method::origin, y_min, y_max);
     }
     if (method == draw_method::errors) {
-        draw_func(painter, f, interpolation_method::error_bessel, y_min, y_max,
-                  delta_x);
-        draw_func(painter, f, interpolation_method::error_spline, y_min, y_max,
-                  delta_x);
+        draw_func(painter, interpolation_method::error_bessel, y_min, y_max);
+        draw_func(painter, interpolation_method::error_spline, y_min, y_max);
     }
     painter.restore();
     change_label(y_min, y_max);
@@ -1,9 +1,18 @@
 #ifndef WINDOW_H
 #define WINDOW_H
 
+#include "envelope_pyramid.h"
+#include "error_norms.h"
 #include "interpolation.h"
+#include "thread_pool.h"
 #include <QLabel>
+#include <QPointF>
 #include <QWidget>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
 
 enum class draw_method {
     bessel,
@@ -25,12 +34,91 @@ class Window : public QWidget
     int disturb = 0;
     int scale = 1;
     double eps = 1e-14;
-    interpolation *f = nullptr;
+    std::shared_ptr<interpolation> f;
     draw_method method = draw_method::bessel;
+    // Interval of the shown fit. a and b change at once on a zoom, the fit
+    // and its samples only when the worker's result arrives, so the curves
+    // are drawn over this interval until then.
+    double shown_a = 0.;
+    double shown_b = 0.;
+    // The shown fit is a coarse preview of the requested one.
+    bool preview = false;
+    // Error norms of the shown fit, when its function is known.
+    fit_errors errors;
+    bool has_errors = false;
 
     QLabel *log_label;
     QLabel *method_label;
 
+    // Curves sampled at the pixel columns of the current width, one buffer
+    // per interpolation_method. Repaints reuse them until the fit or the
+    // width changes.
+    static const int curve_count = 5;
+    int sampled_width = -1;
+    std::vector<double> sample_x;
+    std::vector<double> samples[curve_count];
+    bool sampled[curve_count] = {};
+    // Fits with more segments than sample columns draw the Bessel and spline
+    // curves as exact per-column envelopes, queried from a pyramid instead
+    // of sampled. The pyramids borrow the coefficients of f.
+    std::shared_ptr<const envelope_pyramid> pyramids[curve_count];
+    std::vector<double> lows[curve_count];
+    std::vector<double> highs[curve_count];
+    // Screen-space points of the curve being drawn, reused between curves.
+    std::vector<QPointF> polyline;
+
+    void sample(interpolation_method type);
+    const std::vector<double> &curve(interpolation_method type);
+
+    // Refits and curve sampling run on a worker thread. Every request gets a
+    // new generation; a newer request cancels the one in flight, and results
+    // of older generations are dropped. Fits above preview_n nodes are first
+    // shown as a preview_n-node fit.
+    struct refit_request {
+        double a;
+        double b;
+        int n;
+        int func_id;
+        int disturb;
+        int width;
+        unsigned generation;
+    };
+    struct refit_result {
+        unsigned generation;
+        bool preview;
+        int width;
+        std::shared_ptr<interpolation> f;
+        fit_errors errors;
+        bool has_errors;
+        std::vector<double> x;
+        std::vector<double> samples[curve_count];
+        std::shared_ptr<const envelope_pyramid> pyramids[curve_count];
+        std::vector<double> lows[curve_count];
+        std::vector<double> highs[curve_count];
+    };
+
+    const int n_max = 1 << 22;
+    const int preview_n = 1024;
+    // Error norms sample about this many points in all, and at least one
+    // per segment.
+    const int norm_points = 1 << 20;
+    unsigned generation = 0;
+    unsigned shown_generation = 0;
+    std::thread worker;
+    std::mutex worker_mutex;
+    std::condition_variable worker_cv;
+    refit_request pending = {};
+    bool has_request = false;
+    bool stopping = false;
+    std::atomic<bool> cancel_refit;
+    // Used by the worker only.
+    thread_pool pool;
+
+    void request_refit();
+    void worker_loop();
+    void run_refit(const refit_request &request, int nodes);
+    void apply_refit(const std::shared_ptr<refit_result> &result);
+
   public:
     Window(QWidget *parent, QLabel *log_lab, QLabel *method_lab);
     ~Window();
@@ -40,12 +128,20 @@ class Window : public QWidget
 
     void func_name();
     int parse_command_line(int argc, char *argv[]);
+    // The full fit of the current parameters is shown, not a preview.
+    bool fit_ready() const
+    {
+        return f && !preview && shown_generation == generation;
+    }
     QPointF local2global(double x_loc, double y_loc, double y_min,
                          double y_max);
     void draw_axes(QPainter &painter, double min, double max);
-    void draw_func(QPainter &painter, interpolation *f,
-                   interpolation_method type, double min, double max,
-                   double delta_x);
+    void draw_func(QPainter &painter, interpolation_method type, double min,
+                   double max);
+    void draw_envelope(QPainter &painter, interpolation_method type,
+                       double min, double max);
+    void update_range(interpolation_method type, double &y_min,
+                      double &y_max);
     void change_label(double y_min, double y_max);
 
   public slots: